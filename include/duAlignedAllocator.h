@@ -0,0 +1,112 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_ALIGNED_ALLOCATOR_H
+#define DU_ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace Diamond {
+    /**
+     Size of a cache line on the platforms we target.
+     Objects that are written by different threads should be at least this far apart.
+    */
+    const size_t CACHE_LINE_SIZE = 64;
+
+    // Returns the stricter of two alignments
+    constexpr size_t maxAlignment(size_t a, size_t b) {
+        return a > b ? a : b;
+    }
+
+
+    /**
+     Allocator that returns memory aligned to at least Align bytes
+     (and never less than alignof(T)).
+     Unlike std::allocator before C++17, this honours over-aligned types.
+    */
+    template <typename T, size_t Align = alignof(T)>
+    class AlignedAllocator {
+    public:
+        using value_type = T;
+
+        static const size_t alignment = maxAlignment(Align, alignof(T));
+
+        static_assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+
+        template <class U>
+        struct rebind {
+            using other = AlignedAllocator<U, Align>;
+        };
+
+        AlignedAllocator() {}
+
+        template <class U>
+        AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+
+        T *allocate(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_alloc();
+
+            void *p = alignedAlloc(n * sizeof(T));
+            if (!p)
+                throw std::bad_alloc();
+
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T *p, size_t) {
+#ifdef _WIN32
+            _aligned_free(p);
+#else
+            std::free(p);
+#endif
+        }
+
+    private:
+        static void *alignedAlloc(size_t bytes) {
+#ifdef _WIN32
+            return _aligned_malloc(bytes, alignment);
+#else
+            // posix_memalign requires a multiple of sizeof(void*)
+            const size_t align = alignment < sizeof(void*) ? sizeof(void*) : alignment;
+            void *p = nullptr;
+            if (posix_memalign(&p, align, bytes) != 0)
+                return nullptr;
+            return p;
+#endif
+        }
+    };
+
+    template <typename T, typename U, size_t Align>
+    bool operator==(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&) {
+        return true;
+    }
+
+    template <typename T, typename U, size_t Align>
+    bool operator!=(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&) {
+        return false;
+    }
+}
+
+#endif // DU_ALIGNED_ALLOCATOR_H
@@ -0,0 +1,66 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_BITS_H
+#define DU_BITS_H
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Diamond {
+    namespace Bits {
+        /**
+         Returns the index of the lowest set bit of x.
+         x must not be 0.
+        */
+        inline unsigned countTrailingZeros(uint64_t x) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return (unsigned)index;
+#else
+            return (unsigned)__builtin_ctzll(x);
+#endif
+        }
+
+        /**
+         Returns the number of zero bits above the highest set bit of x.
+         x must not be 0.
+        */
+        inline unsigned countLeadingZeros(uint64_t x) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return 63 - (unsigned)index;
+#else
+            return (unsigned)__builtin_clzll(x);
+#endif
+        }
+
+        /**
+         Returns the smallest n such that 2^n >= x.
+         x must not be 0.
+        */
+        inline unsigned ceilLog2(uint64_t x) {
+            return x == 1 ? 0 : 64 - countLeadingZeros(x - 1);
+        }
+    }
+}
+
+#endif // DU_BITS_H
@@ -0,0 +1,284 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_COMPACT_DUMB_PTR_H
+#define DU_COMPACT_DUMB_PTR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Diamond {
+    /**
+     Global table of free functions used by CompactDumbPtr.
+     Each entry is a function and a context pointer that is passed to it,
+     and is identified by a 16 bit index. Index 0 is never used,
+     so that pointers without a deleter can be freed with delete.
+     Adding and removing entries is thread safe,
+     but an entry must not be removed while pointers still refer to it.
+    */
+    class DumbDeleterRegistry {
+    public:
+        using FreeFunc = void (*)(void *context, void *ptr);
+
+        static const size_t CAPACITY = 1 << 16;
+
+        /**
+         Adds an entry and returns its index.
+         Throws std::length_error if every index is taken.
+        */
+        static uint16_t add(FreeFunc func, void *context) {
+            Table &t = table();
+            std::lock_guard<std::mutex> lock(t.mutex);
+
+            uint16_t index;
+            if (!t.unused.empty()) {
+                index = t.unused.back();
+                t.unused.pop_back();
+            }
+            else if (t.next < CAPACITY) {
+                index = (uint16_t)t.next++;
+            }
+            else {
+                throw std::length_error("DumbDeleterRegistry is full");
+            }
+
+            t.entries[index].func = func;
+            t.entries[index].context = context;
+            return index;
+        }
+
+        /**
+         Makes the given index available to add() again.
+        */
+        static void remove(uint16_t index) {
+            Table &t = table();
+            std::lock_guard<std::mutex> lock(t.mutex);
+
+            t.entries[index].func = nullptr;
+            t.entries[index].context = nullptr;
+            t.unused.push_back(index);
+        }
+
+        /**
+         Calls the function at the given index with its context and ptr.
+        */
+        static void free(uint16_t index, void *ptr) {
+            const Entry &e = table().entries[index];
+            e.func(e.context, ptr);
+        }
+
+    private:
+        struct Entry {
+            FreeFunc func;
+            void *context;
+        };
+
+        struct Table {
+            Entry entries[CAPACITY];
+            std::vector<uint16_t> unused; // Removed indices
+            size_t next = 1; // Lowest index that has never been used
+            std::mutex mutex;
+        };
+
+        static Table &table() {
+            // Zero initialized, and only the pages of entries that are used are touched
+            static Table t;
+            return t;
+        }
+    };
+
+
+    /**
+     Adds an entry to the DumbDeleterRegistry for as long as it lives.
+    */
+    class DumbDeleterRegistration {
+    public:
+        DumbDeleterRegistration(DumbDeleterRegistry::FreeFunc func, void *context)
+            : m_index(DumbDeleterRegistry::add(func, context)) {}
+
+        DumbDeleterRegistration(const DumbDeleterRegistration&) = delete;
+        DumbDeleterRegistration &operator=(const DumbDeleterRegistration&) = delete;
+
+        ~DumbDeleterRegistration() {
+            DumbDeleterRegistry::remove(m_index);
+        }
+
+        uint16_t index() const { return m_index; }
+
+    private:
+        uint16_t m_index;
+    };
+
+    /**
+     Like DumbPtr, but 8 bytes instead of 16, and freeing it
+     calls a function pointer from the DumbDeleterRegistry instead of a virtual function.
+     The registry index of the deleter is kept in the 16 high bits of the pointer,
+     which are unused by user space addresses on x86-64 and AArch64
+     (with 48 bit virtual addresses, as on Linux, macOS and Windows by default).
+     Constructing one from a pointer that uses those bits, as with 5-level paging
+     or tagged pointers, throws std::invalid_argument.
+     A pointer without a deleter is freed with delete.
+     Does not automatically free the stored pointer.
+     Safe to copy and assign.
+    */
+    template <typename T>
+    class CompactDumbPtr {
+    public:
+        static_assert(sizeof(void*) == 8, "CompactDumbPtr requires 64 bit pointers");
+
+        static const unsigned INDEX_SHIFT = 48;
+        static const uint64_t ADDRESS_MASK = ((uint64_t)1 << INDEX_SHIFT) - 1;
+
+        CompactDumbPtr() : bits(0) {}
+        CompactDumbPtr(std::nullptr_t) : bits(0) {}
+
+        CompactDumbPtr(T *ptr) : bits(pack(ptr, 0)) {}
+
+        CompactDumbPtr(T *ptr, uint16_t deleterIndex) : bits(pack(ptr, deleterIndex)) {}
+
+        // implicit converting constructor
+        template <typename Y>
+        CompactDumbPtr(const CompactDumbPtr<Y> &p) : bits(pack(p.get(), p.get_deleter_index())) {}
+
+        T *get() const { return (T*)(uintptr_t)(bits & ADDRESS_MASK); }
+
+        uint16_t get_deleter_index() const { return (uint16_t)(bits >> INDEX_SHIFT); }
+
+        T &operator*() const { return *get(); }
+
+        T *operator->() const { return get(); }
+
+        void free() {
+            uint16_t index = get_deleter_index();
+            if (index)  DumbDeleterRegistry::free(index, get());
+            else        delete get();
+            bits = 0;
+        }
+
+        explicit operator bool() const { return (bits & ADDRESS_MASK) != 0; }
+
+        // conversion operator
+        operator T*() const {
+            return get();
+        }
+
+    private:
+        static uint64_t pack(T *ptr, uint16_t deleterIndex) {
+            if (((uint64_t)(uintptr_t)ptr & ~ADDRESS_MASK) != 0)
+                throw std::invalid_argument("CompactDumbPtr: pointer does not fit in 48 bits");
+            return (uint64_t)(uintptr_t)ptr | ((uint64_t)deleterIndex << INDEX_SHIFT);
+        }
+
+
+        uint64_t bits;
+    };
+
+    // Comparison operators
+
+    template <typename T, typename U>
+    bool operator==(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() == b.get();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() != b.get();
+    }
+
+    template <typename T, typename U>
+    bool operator<(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() < b.get();
+    }
+
+    template <typename T, typename U>
+    bool operator>(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() > b.get();
+    }
+
+    template <typename T, typename U>
+    bool operator<=(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() <= b.get();
+    }
+
+    template <typename T, typename U>
+    bool operator>=(const CompactDumbPtr<T> &a, const CompactDumbPtr<U> &b) {
+        return a.get() >= b.get();
+    }
+
+
+    template <typename T>
+    bool operator==(const CompactDumbPtr<T> &a, std::nullptr_t b) {
+        return a.get() == b;
+    }
+    template <typename T>
+    bool operator==(std::nullptr_t a, const CompactDumbPtr<T> &b) {
+        return a == b.get();
+    }
+
+    template <typename T>
+    bool operator!=(const CompactDumbPtr<T> &a, std::nullptr_t b) {
+        return a.get() != b;
+    }
+    template <typename T>
+    bool operator!=(std::nullptr_t a, const CompactDumbPtr<T> &b) {
+        return a != b.get();
+    }
+
+    // Ordering against nullptr goes through std::less, like std::unique_ptr,
+    // because built-in ordered comparisons with nullptr are ill-formed
+
+    template <typename T>
+    bool operator<(const CompactDumbPtr<T> &a, std::nullptr_t) {
+        return std::less<T*>()(a.get(), nullptr);
+    }
+    template <typename T>
+    bool operator<(std::nullptr_t, const CompactDumbPtr<T> &b) {
+        return std::less<T*>()(nullptr, b.get());
+    }
+
+    template <typename T>
+    bool operator>(const CompactDumbPtr<T> &a, std::nullptr_t) {
+        return nullptr < a;
+    }
+    template <typename T>
+    bool operator>(std::nullptr_t, const CompactDumbPtr<T> &b) {
+        return b < nullptr;
+    }
+
+    template <typename T>
+    bool operator<=(const CompactDumbPtr<T> &a, std::nullptr_t) {
+        return !(nullptr < a);
+    }
+    template <typename T>
+    bool operator<=(std::nullptr_t, const CompactDumbPtr<T> &b) {
+        return !(b < nullptr);
+    }
+
+    template <typename T>
+    bool operator>=(const CompactDumbPtr<T> &a, std::nullptr_t) {
+        return !(a < nullptr);
+    }
+    template <typename T>
+    bool operator>=(std::nullptr_t, const CompactDumbPtr<T> &b) {
+        return !(nullptr < b);
+    }
+}
+
+#endif // DU_COMPACT_DUMB_PTR_H
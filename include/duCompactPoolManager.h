@@ -0,0 +1,62 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_COMPACT_POOL_MANAGER_H
+#define DU_COMPACT_POOL_MANAGER_H
+
+#include <memory>
+#include "duCompactDumbPtr.h"
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     Like DumbPoolManager but for CompactDumbPtrs.
+     The manager adds its pool to the DumbDeleterRegistry on construction
+     and removes it on destruction, so it must outlive the pointers it makes.
+    */
+    template <typename ElemType,
+              class Allocator = std::allocator<MemNode<ElemType> >,
+              class PoolType = MemPool<ElemType, Allocator> >
+    class CompactPoolManager {
+    public:
+        CompactPoolManager(size_t chunkSize = 10,
+                           Allocator allocator = Allocator(),
+                           size_t maxChunkSize = 0)
+            : m_registration(&freeFromPool, &m_pool),
+              m_pool(chunkSize, allocator, maxChunkSize) {}
+
+        template <typename... Args>
+        CompactDumbPtr<ElemType> make(Args&&... args) {
+            return CompactDumbPtr<ElemType>(m_pool.make(std::forward<Args>(args)...),
+                                            m_registration.index());
+        }
+
+
+        uint16_t deleterIndex() const { return m_registration.index(); }
+
+    protected:
+        static void freeFromPool(void *pool, void *ptr) {
+            static_cast<PoolType*>(pool)->free(static_cast<ElemType*>(ptr));
+        }
+
+
+        DumbDeleterRegistration m_registration;
+        PoolType m_pool;
+    };
+}
+
+#endif // DU_COMPACT_POOL_MANAGER_H
@@ -0,0 +1,255 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_CONCURRENT_MEM_POOL_H
+#define DU_CONCURRENT_MEM_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     A memory pool like MemPool whose make and free can be called
+     from any number of threads at once.
+
+     The free list is a lock-free stack. Its head packs a version tag
+     next to the pointer, and the tag is incremented on every update,
+     so a thread that was preempted in the middle of a pop cannot
+     succeed with a stale view of the list (the ABA problem).
+     On 64-bit platforms the pointer takes the low 48 bits and the tag the high 16 bits.
+     A chunk that the allocator places above the low 48 bits of the address space
+     (as with 5-level paging) cannot be packed, so it is given back and treated
+     like a memory error.
+
+     Each node keeps its free list link in its own word ahead of the element,
+     rather than sharing storage with it as in MemPool. A thread that is about to
+     lose a pop race may still read the link of a node that another thread
+     has just popped, and the element being constructed must not overwrite it.
+
+     When the free list runs out, one thread wins a compare-and-swap
+     for the right to allocate and install a new chunk. Other threads that
+     run out at the same time wait for it instead of allocating their own chunk,
+     so only growth (which calls into the allocator) can block.
+
+     Like MemPool, this class does not call the destructors of
+     outstanding elements when it goes out of scope.
+    */
+    template <typename ElemType, class Allocator = std::allocator<MemNode<ElemType> > >
+    class ConcurrentMemPool {
+        static_assert(sizeof(void*) <= sizeof(uint64_t),
+                      "ConcurrentMemPool packs a pointer and a tag into 64 bits");
+
+        struct Node {
+            Node() : next(nullptr) {}
+
+            ElemType *elem() { return reinterpret_cast<ElemType*>(storage); }
+
+            std::atomic<Node*> next;
+            alignas(ElemType) unsigned char storage[sizeof(ElemType)];
+        };
+
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeAllocTraits = std::allocator_traits<NodeAllocator>;
+
+    public:
+        ConcurrentMemPool(size_t chunkSize = 64,
+                          Allocator allocator = Allocator())
+            : m_freeHead(0),
+              m_chunks(nullptr),
+              m_growing(false),
+              m_chunkSize(chunkSize > 0 ? chunkSize : 1),
+              m_allocator(allocator) {
+            grow();
+        }
+
+        ConcurrentMemPool(const ConcurrentMemPool&) = delete;
+        ConcurrentMemPool &operator=(const ConcurrentMemPool&) = delete;
+
+        ~ConcurrentMemPool() {
+            Node *chunk = m_chunks.load(std::memory_order_acquire);
+
+            // delete all memory chunks
+            while (chunk) {
+                Node *next = getNextChunk(chunk);
+                NodeAllocTraits::deallocate(m_allocator, chunk, m_chunkSize + 1);
+                chunk = next;
+            }
+        }
+
+
+        template <typename... Args>
+        ElemType *make(Args&&... args) {
+            Node *node = pop();
+            if (!node)
+                return nullptr;
+
+            return new (node->elem()) ElemType(std::forward<Args>(args)...);
+        }
+
+
+        void free(ElemType *ptr) {
+            if (ptr) {
+                ptr->~ElemType();
+
+                Node *freed = reinterpret_cast<Node*>(reinterpret_cast<unsigned char*>(ptr)
+                                                      - offsetof(Node, storage));
+                push(freed, freed);
+            }
+        }
+
+
+        /**
+         Returns true if the free list head is lock-free on this platform.
+        */
+        bool is_lock_free() const {
+            return m_freeHead.is_lock_free();
+        }
+
+    private:
+        static const unsigned PTR_BITS = sizeof(void*) == 8 ? 48 : 32;
+        static const uint64_t PTR_MASK = (1ULL << PTR_BITS) - 1;
+
+        static uint64_t pack(Node *ptr, uint64_t tag) {
+            return (uint64_t)(uintptr_t)ptr | (tag << PTR_BITS);
+        }
+
+        // Returns true if every byte of count nodes from first can be packed
+        static bool packable(const Node *first, size_t count) {
+            return ((uint64_t)(uintptr_t)(first + count - 1) >> PTR_BITS) == 0;
+        }
+
+        static Node *ptrOf(uint64_t tagged) {
+            return (Node*)(uintptr_t)(tagged & PTR_MASK);
+        }
+
+        static uint64_t tagOf(uint64_t tagged) {
+            return tagged >> PTR_BITS;
+        }
+
+
+        Node *pop() {
+            uint64_t head = m_freeHead.load(std::memory_order_acquire);
+
+            while (true) {
+                Node *node = ptrOf(head);
+                if (!node) {
+                    if (!grow())
+                        return nullptr;
+                    head = m_freeHead.load(std::memory_order_acquire);
+                    continue;
+                }
+
+                // node may be popped and reused by another thread before this read.
+                // Then the tag will have changed and the exchange below fails.
+                // The link is never overwritten by an element, so the read itself is safe.
+                Node *next = node->next.load(std::memory_order_relaxed);
+
+                if (m_freeHead.compare_exchange_weak(head, pack(next, tagOf(head) + 1),
+                                                     std::memory_order_acquire,
+                                                     std::memory_order_acquire))
+                    return node;
+            }
+        }
+
+        // Pushes a chain of nodes, linked through Node::next from first to last.
+        void push(Node *first, Node *last) {
+            uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+
+            do {
+                last->next.store(ptrOf(head), std::memory_order_relaxed);
+            } while (!m_freeHead.compare_exchange_weak(head, pack(first, tagOf(head) + 1),
+                                                       std::memory_order_release,
+                                                       std::memory_order_relaxed));
+        }
+
+
+        // Allocates a new chunk and pushes its nodes onto the free list,
+        // or waits for another thread that is already doing so.
+        // Returns false if there was a memory error.
+        bool grow() {
+            bool expected = false;
+            if (!m_growing.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                while (m_growing.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                return true;
+            }
+
+            // Another thread may have refilled the free list
+            // between our failed pop and winning the growth flag
+            if (ptrOf(m_freeHead.load(std::memory_order_acquire))) {
+                m_growing.store(false, std::memory_order_release);
+                return true;
+            }
+
+            Node *chunk;
+            try {
+                chunk = NodeAllocTraits::allocate(m_allocator, m_chunkSize + 1); // + 1 to hold pointer to next chunk
+            }
+            catch (...) {
+                m_growing.store(false, std::memory_order_release);
+                throw;
+            }
+
+            if (!chunk) {
+                m_growing.store(false, std::memory_order_release);
+                return false;
+            }
+
+            if (!packable(chunk, m_chunkSize + 1)) {
+                NodeAllocTraits::deallocate(m_allocator, chunk, m_chunkSize + 1);
+                m_growing.store(false, std::memory_order_release);
+                return false;
+            }
+
+            // link all nodes in the chunk to the next adjacent node
+            for (Node *p = chunk; p < chunk + m_chunkSize; ++p)
+                new (p) Node();
+            for (Node *p = chunk; p < chunk + m_chunkSize - 1; ++p)
+                p->next.store(p + 1, std::memory_order_relaxed);
+
+            // the trailing node links the chunk into the chunk list
+            new (chunk + m_chunkSize) Node();
+            (chunk + m_chunkSize)->next.store(m_chunks.load(std::memory_order_relaxed),
+                                              std::memory_order_relaxed);
+            m_chunks.store(chunk, std::memory_order_release);
+
+            push(chunk, chunk + m_chunkSize - 1);
+
+            m_growing.store(false, std::memory_order_release);
+            return true;
+        }
+
+        // Get pointer to the next chunk in the chunk list
+        Node *getNextChunk(Node *chunk) const {
+            return (chunk + m_chunkSize)->next.load(std::memory_order_relaxed);
+        }
+
+
+        std::atomic<uint64_t> m_freeHead; // Tagged pointer to first element of free list
+        std::atomic<Node*> m_chunks; // Pointer to most recently allocated chunk
+        std::atomic<bool> m_growing; // Held by the thread that is allocating a new chunk
+
+        size_t m_chunkSize;
+        NodeAllocator m_allocator;
+    };
+}
+
+#endif // DU_CONCURRENT_MEM_POOL_H
@@ -0,0 +1,80 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_DIRECTORY_POOL_MANAGER_H
+#define DU_DIRECTORY_POOL_MANAGER_H
+
+#include "duMemPool.h"
+#include "duPoolDirectory.h"
+
+namespace Diamond {
+
+    /**
+     Memory pool container whose chunks are registered in the PoolDirectory,
+     so that the raw pointers it makes can be freed with pool_free()
+     without storing a deleter alongside each pointer.
+     Because DirectoryAllocator pads every chunk to whole pages, chunk sizes are
+     rounded up to fill whole pages, and the default chunk is a single page.
+     Like PoolManager, it must outlive the pointers it makes.
+    */
+    template <typename ElemType>
+    class DirectoryPoolManager {
+    public:
+        using Allocator = DirectoryAllocator<MemNode<ElemType> >;
+        using PoolType = MemPool<ElemType, Allocator>;
+
+        DirectoryPoolManager(size_t chunkSize = 0, size_t maxChunkSize = 0)
+            : m_registration(&freeFromPool, &m_pool),
+              m_pool(fillPages(chunkSize > 0 ? chunkSize : 1),
+                     Allocator(m_registration.index()),
+                     fillPages(maxChunkSize)) {}
+
+        template <typename... Args>
+        ElemType *make(Args&&... args) {
+            return m_pool.make(std::forward<Args>(args)...);
+        }
+
+        void free(ElemType *ptr) {
+            m_pool.free(ptr);
+        }
+
+
+        uint16_t deleterIndex() const { return m_registration.index(); }
+
+        /**
+         Returns the number of elements that fill the pages that count elements need.
+        */
+        static size_t fillPages(size_t count) {
+            using TNode = typename PoolType::TNode;
+            const size_t perPage = sizeof(TNode) < PoolDirectory::PAGE_BYTES
+                                   ? PoolDirectory::PAGE_BYTES / sizeof(TNode) : 1;
+            return (count + perPage - 1) / perPage * perPage;
+        }
+
+    protected:
+        static void freeFromPool(void *pool, void *ptr) {
+            static_cast<PoolType*>(pool)->free(static_cast<ElemType*>(ptr));
+        }
+
+
+        // Declared before the pool so that the index is only reused
+        // after the pool's chunks have been removed from the directory
+        DumbDeleterRegistration m_registration;
+        PoolType m_pool;
+    };
+}
+
+#endif // DU_DIRECTORY_POOL_MANAGER_H
@@ -0,0 +1,313 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_EPOCH_DOMAIN_H
+#define DU_EPOCH_DOMAIN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "duAlignedAllocator.h"
+#include "duCompactDumbPtr.h"
+#include "duDumbPtr.h"
+
+namespace Diamond {
+
+    /**
+     Epoch-based reclamation for objects that are read by some threads
+     while another thread frees them, such as objects of a DumbPoolManager
+     that a render thread reads while the simulation thread frees them.
+
+     Each thread takes part through its own EpochDomain::Participant.
+     Readers wrap their reads in an EpochDomain::Guard, which only publishes
+     the current epoch in the participant and never takes a lock.
+     Instead of freeing an object that readers may still hold, a thread retires it,
+     which queues it in the participant's limbo list for the current epoch.
+     The global epoch only advances when every thread inside a guard has seen it,
+     so once it has advanced twice past the epoch an object was retired in,
+     no reader can still hold the object, and the object is freed.
+     Retired objects are freed in batches, on the thread that retired them,
+     so a pool that is only ever freed by its owning thread stays that way.
+
+     A Participant must only be used by one thread,
+     and must be destroyed before the EpochDomain it was created with.
+     Readers must not keep pointers to retired objects after leaving a guard.
+    */
+    class EpochDomain {
+    public:
+        using FreeFunc = void (*)(void *context, void *ptr);
+
+        /**
+         Per-thread front end of an EpochDomain.
+        */
+        class Participant {
+        public:
+            /**
+             Retired objects are collected whenever batchSize of them are pending.
+            */
+            explicit Participant(EpochDomain &domain, size_t batchSize = 64)
+                : m_domain(domain),
+                  m_state(0),
+                  m_depth(0),
+                  m_batchSize(batchSize > 0 ? batchSize : 1),
+                  m_pending(0) {
+                for (Limbo &limbo : m_limbo)
+                    limbo.epoch = 0;
+
+                m_domain.add(this);
+            }
+
+            Participant(const Participant&) = delete;
+            Participant &operator=(const Participant&) = delete;
+
+            /**
+             Waits until every object this participant retired can be freed, and frees it.
+             This waits for other threads to leave their guards.
+            */
+            ~Participant() {
+                assert(m_depth == 0);
+
+                while (m_pending > 0) {
+                    collect();
+                    if (m_pending > 0)
+                        std::this_thread::yield();
+                }
+
+                m_domain.remove(this);
+            }
+
+
+            /**
+             Enters a read-side critical section. May be nested.
+             Prefer EpochDomain::Guard.
+            */
+            void enter() {
+                if (m_depth++ == 0) {
+                    // Sequentially consistent, so that the epoch is published
+                    // before any shared pointer is read
+                    m_state.store(active(m_domain.m_epoch.load(std::memory_order_seq_cst)),
+                                  std::memory_order_seq_cst);
+                }
+            }
+
+            /**
+             Leaves a read-side critical section.
+            */
+            void exit() {
+                assert(m_depth > 0);
+                if (--m_depth == 0)
+                    m_state.store(0, std::memory_order_release);
+            }
+
+
+            /**
+             Queues ptr to be freed with func(context, ptr)
+             once no reader can hold it any more.
+             The object must already be unreachable for new readers.
+            */
+            void retire(void *ptr, FreeFunc func, void *context) {
+                uint64_t epoch = m_domain.m_epoch.load(std::memory_order_seq_cst);
+
+                // The list for this epoch last held objects from at least three epochs ago,
+                // which are safe to free
+                Limbo &limbo = m_limbo[epoch % 3];
+                if (limbo.epoch != epoch) {
+                    flush(limbo);
+                    limbo.epoch = epoch;
+                }
+
+                limbo.retired.push_back(Retired{ptr, func, context});
+                if (++m_pending >= m_batchSize)
+                    collect();
+            }
+
+            /**
+             Retires a dumb pointer, which is later freed like DumbPtr::free().
+            */
+            template <typename T>
+            void retire(DumbPtr<T> ptr) {
+                if (!ptr)
+                    return;
+
+                if (ptr.get_deleter())
+                    retire((void*)ptr.get(), &freeWithDeleter, (void*)ptr.get_deleter());
+                else
+                    retire((void*)ptr.get(), &deleteAs<T>, nullptr);
+            }
+
+            /**
+             Retires a compact dumb pointer, which is later freed like CompactDumbPtr::free().
+            */
+            template <typename T>
+            void retire(CompactDumbPtr<T> ptr) {
+                if (!ptr)
+                    return;
+
+                if (ptr.get_deleter_index())
+                    retire((void*)ptr.get(), &freeWithRegistry,
+                           (void*)(uintptr_t)ptr.get_deleter_index());
+                else
+                    retire((void*)ptr.get(), &deleteAs<T>, nullptr);
+            }
+
+
+            /**
+             Tries to advance the global epoch,
+             then frees the retired objects that no reader can hold any more.
+            */
+            void collect() {
+                m_domain.tryAdvance();
+
+                uint64_t epoch = m_domain.m_epoch.load(std::memory_order_seq_cst);
+                for (Limbo &limbo : m_limbo) {
+                    if (limbo.epoch + 2 <= epoch)
+                        flush(limbo);
+                }
+            }
+
+            /**
+             Returns the number of retired objects that have not been freed yet.
+            */
+            size_t pending() const { return m_pending; }
+
+        private:
+            friend class EpochDomain;
+
+            struct Retired {
+                void *ptr;
+                FreeFunc func;
+                void *context;
+            };
+
+            // Objects retired while the global epoch was the given epoch
+            struct Limbo {
+                std::vector<Retired> retired;
+                uint64_t epoch;
+            };
+
+
+            // Participant state while inside a guard that started in the given epoch.
+            // 0 means outside of any guard.
+            static uint64_t active(uint64_t epoch) { return (epoch << 1) | 1; }
+
+            void flush(Limbo &limbo) {
+                for (const Retired &r : limbo.retired)
+                    r.func(r.context, r.ptr);
+
+                m_pending -= limbo.retired.size();
+                limbo.retired.clear();
+            }
+
+            static void freeWithDeleter(void *deleter, void *ptr) {
+                static_cast<const DumbDeleter*>(deleter)->free(ptr);
+            }
+
+            static void freeWithRegistry(void *index, void *ptr) {
+                DumbDeleterRegistry::free((uint16_t)(uintptr_t)index, ptr);
+            }
+
+            template <typename T>
+            static void deleteAs(void*, void *ptr) {
+                delete static_cast<T*>(ptr);
+            }
+
+
+            EpochDomain &m_domain;
+
+            // Read by threads that advance the epoch, so kept off the lines
+            // that only this participant's thread touches
+            alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_state;
+
+            alignas(CACHE_LINE_SIZE) unsigned m_depth; // Nesting depth of enter() calls
+            size_t m_batchSize;
+            size_t m_pending; // Number of retired objects in all limbo lists
+            Limbo m_limbo[3];
+        };
+
+
+        /**
+         Scoped read-side critical section of a Participant.
+        */
+        class Guard {
+        public:
+            explicit Guard(Participant &participant) : m_participant(participant) {
+                m_participant.enter();
+            }
+
+            Guard(const Guard&) = delete;
+            Guard &operator=(const Guard&) = delete;
+
+            ~Guard() {
+                m_participant.exit();
+            }
+
+        private:
+            Participant &m_participant;
+        };
+
+
+        EpochDomain() : m_epoch(0) {}
+
+        EpochDomain(const EpochDomain&) = delete;
+        EpochDomain &operator=(const EpochDomain&) = delete;
+
+        ~EpochDomain() {
+            assert(m_participants.empty());
+        }
+
+
+        uint64_t epoch() const { return m_epoch.load(std::memory_order_relaxed); }
+
+    private:
+        void add(Participant *participant) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_participants.push_back(participant);
+        }
+
+        void remove(Participant *participant) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_participants.erase(std::find(m_participants.begin(), m_participants.end(), participant));
+        }
+
+        // Advances the global epoch if every participant inside a guard has seen it.
+        // Only reclaiming threads call this, so readers never wait on the mutex.
+        bool tryAdvance() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+            for (const Participant *p : m_participants) {
+                uint64_t state = p->m_state.load(std::memory_order_seq_cst);
+                if (state != 0 && state != Participant::active(epoch))
+                    return false;
+            }
+
+            m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+            return true;
+        }
+
+
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_epoch;
+
+        std::mutex m_mutex; // Guards m_participants
+        std::vector<Participant*> m_participants;
+    };
+}
+
+#endif // DU_EPOCH_DOMAIN_H
@@ -0,0 +1,217 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_FRAME_ARENA_H
+#define DU_FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Diamond {
+
+    /**
+     Linear allocator for objects that live for one frame.
+     Memory is bumped off large blocks and never freed one object at a time;
+     reset() makes all of it available again at the end of the frame.
+     Blocks are kept across frames, so after the first few frames
+     allocating does not touch the heap.
+
+     Objects made with make() that are not trivially destructible
+     have their destructors called by reset(), in reverse order of construction.
+     Memory from allocate() is never destructed.
+
+     Not thread safe.
+    */
+    class FrameArena {
+    public:
+        explicit FrameArena(size_t blockSize = 64 * 1024)
+            : m_blockSize(blockSize > 0 ? blockSize : 1),
+              m_block(0),
+              m_offset(0),
+              m_destructors(nullptr) {}
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena &operator=(const FrameArena&) = delete;
+
+        ~FrameArena() {
+            reset();
+            for (const Block &block : m_blocks)
+                ::operator delete(block.data);
+        }
+
+
+        /**
+         Returns bytes of uninitialized memory aligned to align (a power of two).
+        */
+        void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+            if (m_block < m_blocks.size()) {
+                void *p = bump(m_blocks[m_block], bytes, align);
+                if (p)
+                    return p;
+            }
+            return allocateSlow(bytes, align);
+        }
+
+
+        /**
+         Constructs an object that lives until the next reset().
+        */
+        template <typename T, typename... Args>
+        T *make(Args&&... args) {
+            T *obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+            if (!std::is_trivially_destructible<T>::value) {
+                // The record lives in the arena too, so registering costs no heap traffic
+                Destructor *record = new (allocate(sizeof(Destructor), alignof(Destructor)))
+                    Destructor{&destroy<T>, obj, m_destructors};
+                m_destructors = record;
+            }
+
+            return obj;
+        }
+
+
+        /**
+         Calls the registered destructors and makes all blocks available again.
+         O(1) if no destructors were registered.
+        */
+        void reset() {
+            for (Destructor *d = m_destructors; d; d = d->prev)
+                d->destroy(d->obj);
+            m_destructors = nullptr;
+
+            m_block = 0;
+            m_offset = 0;
+        }
+
+
+        /**
+         Returns the number of blocks held by this arena.
+        */
+        size_t blockCount() const { return m_blocks.size(); }
+
+    private:
+        struct Block {
+            char *data;
+            size_t size;
+        };
+
+        struct Destructor {
+            void (*destroy)(void*);
+            void *obj;
+            Destructor *prev; // Destructor registered before this one
+        };
+
+        template <typename T>
+        static void destroy(void *obj) {
+            static_cast<T*>(obj)->~T();
+        }
+
+
+        // Returns memory from the current block, or nullptr if it does not fit
+        void *bump(const Block &block, size_t bytes, size_t align) {
+            uintptr_t base = (uintptr_t)block.data;
+            uintptr_t start = (base + m_offset + align - 1) & ~(uintptr_t)(align - 1);
+            if (start - base > block.size || bytes > block.size - (start - base))
+                return nullptr;
+
+            m_offset = start - base + bytes;
+            return (void*)start;
+        }
+
+        // Moves on to the next block that fits the request, allocating one if needed
+        void *allocateSlow(size_t bytes, size_t align) {
+            size_t needed = bytes + align - 1;
+
+            while (++m_block < m_blocks.size()) {
+                m_offset = 0;
+                if (m_blocks[m_block].size >= needed)
+                    return bump(m_blocks[m_block], bytes, align);
+            }
+
+            // Oversized requests get a block of their own
+            size_t size = needed > m_blockSize ? needed : m_blockSize;
+            m_blocks.reserve(m_blocks.size() + 1);
+            m_blocks.push_back(Block{static_cast<char*>(::operator new(size)), size});
+            m_block = m_blocks.size() - 1;
+            m_offset = 0;
+            return bump(m_blocks[m_block], bytes, align);
+        }
+
+
+        std::vector<Block> m_blocks;
+        size_t m_blockSize; // Size of a normal block
+        size_t m_block; // Index of the block being bumped from
+        size_t m_offset; // Offset of the first free byte in the current block
+
+        Destructor *m_destructors; // Most recently registered destructor
+    };
+
+
+    /**
+     Two FrameArenas that take turns, so that what is made during one frame
+     stays valid through the next frame as well.
+     Call nextFrame() at the start of every frame.
+    */
+    class DoubleBufferedFrameArena {
+    public:
+        explicit DoubleBufferedFrameArena(size_t blockSize = 64 * 1024)
+            : m_even(blockSize),
+              m_odd(blockSize),
+              m_frame(0) {}
+
+
+        /**
+         Switches to the other arena and resets it,
+         ending the lifetime of what was made two frames ago.
+        */
+        void nextFrame() {
+            ++m_frame;
+            current().reset();
+        }
+
+        void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+            return current().allocate(bytes, align);
+        }
+
+        template <typename T, typename... Args>
+        T *make(Args&&... args) {
+            return current().template make<T>(std::forward<Args>(args)...);
+        }
+
+
+        /**
+         Arena for this frame.
+        */
+        FrameArena &current() { return m_frame & 1 ? m_odd : m_even; }
+
+        /**
+         Arena that was used in the previous frame, whose objects are still valid.
+        */
+        FrameArena &previous() { return m_frame & 1 ? m_even : m_odd; }
+
+    private:
+        FrameArena m_even; // Arena of even numbered frames
+        FrameArena m_odd; // Arena of odd numbered frames
+        size_t m_frame; // Number of the current frame
+    };
+}
+
+#endif // DU_FRAME_ARENA_H
@@ -0,0 +1,214 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_HANDLE_POOL_H
+#define DU_HANDLE_POOL_H
+
+#include <cstdint>
+#include <vector>
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     32 bit reference to an element of a HandlePool.
+     From the high bits down, it holds a 12 bit generation, an 8 bit chunk index
+     and a 12 bit slot in the chunk. The generation of a slot changes every time
+     its element is made or freed, so a handle to a freed element is detected by a single compare.
+     A default constructed handle is null and never refers to an element.
+    */
+    template <typename T>
+    class PoolHandle {
+    public:
+        static const unsigned GENERATION_BITS = 12;
+        static const unsigned CHUNK_BITS = 8;
+        static const unsigned SLOT_BITS = 12;
+
+        PoolHandle() : m_value(0) {}
+
+        PoolHandle(uint16_t generation, uint8_t chunk, uint16_t slot)
+            : m_value((uint32_t)generation << (CHUNK_BITS + SLOT_BITS)
+                      | (uint32_t)chunk << SLOT_BITS
+                      | (slot & ((1u << SLOT_BITS) - 1))) {}
+
+        uint16_t generation() const { return (uint16_t)(m_value >> (CHUNK_BITS + SLOT_BITS)); }
+        uint8_t chunk() const { return (uint8_t)(m_value >> SLOT_BITS); }
+        uint16_t slot() const { return (uint16_t)(m_value & ((1u << SLOT_BITS) - 1)); }
+
+        uint32_t value() const { return m_value; }
+
+        explicit operator bool() const { return m_value != 0; }
+
+        bool operator==(const PoolHandle &other) const { return m_value == other.m_value; }
+        bool operator!=(const PoolHandle &other) const { return m_value != other.m_value; }
+
+    private:
+        uint32_t m_value;
+    };
+
+
+    /**
+     A MemPool whose elements are referred to by PoolHandles instead of pointers.
+     A handle is resolved through the pool's chunk directory.
+     Each slot keeps a generation that starts at 0 and is incremented both when
+     its element is made and when it is freed, so the generation is odd exactly
+     while the slot is live. A handle carries the odd generation its element was made with,
+     so it stops resolving as soon as the element is freed, and a handle to a slot
+     that has never been handed out does not resolve at all.
+     Instead of letting a generation wrap around, which would let old handles
+     resolve again, a slot is retired for good when its generation runs out,
+     after 2048 elements have been made in it. Its node is then never reused.
+
+     A pool holds at most MAX_CHUNKS chunks of at most MAX_SLOTS elements,
+     and make() returns a null handle when it would need more.
+     Chunks are never trimmed, so a handle's chunk index stays meaningful.
+    */
+    template <typename ElemType, class Allocator = std::allocator<MemNode<ElemType> > >
+    class HandlePool : protected MemPool<ElemType, Allocator> {
+    public:
+        using PoolType = MemPool<ElemType, Allocator>;
+        using TNode = typename PoolType::TNode;
+        using Handle = PoolHandle<ElemType>;
+
+        static const size_t MAX_CHUNKS = (size_t)1 << Handle::CHUNK_BITS;
+        static const size_t MAX_SLOTS = (size_t)1 << Handle::SLOT_BITS;
+
+        HandlePool(size_t chunkSize = 256,
+                   Allocator allocator = Allocator(),
+                   size_t maxChunkSize = MAX_SLOTS)
+            : PoolType(chunkSize < MAX_SLOTS ? chunkSize : MAX_SLOTS,
+                       allocator,
+                       maxChunkSize < MAX_SLOTS ? maxChunkSize : MAX_SLOTS) {}
+
+
+        template <typename... Args>
+        Handle make(Args&&... args) {
+            TNode *node = this->allocateNode();
+            if (!node)
+                return Handle();
+
+            size_t index = this->findChunk(node);
+            if (index >= MAX_CHUNKS) {
+                this->deallocateNode(node);
+                return Handle();
+            }
+
+            try {
+                new (&(node->elem)) ElemType(std::forward<Args>(args)...);
+            }
+            catch (...) {
+                this->deallocateNode(new (node) TNode());
+                throw;
+            }
+
+            size_t slot = node - this->m_chunks[index].nodes;
+            uint16_t generation = ++generations(index)[slot];
+            return Handle(generation, (uint8_t)index, (uint16_t)slot);
+        }
+
+
+        /**
+         Destroys the element that the handle refers to.
+         Does nothing if the handle is null or stale.
+        */
+        void free(Handle handle) {
+            ElemType *ptr = get(handle);
+            if (!ptr)
+                return;
+
+            uint16_t &generation = m_generations[handle.chunk()][handle.slot()];
+            ptr->~ElemType();
+
+            if (generation == MAX_GENERATION) {
+                // Retire the slot. Its generation stays even, so it is never live again,
+                // and its node is not returned to the free list.
+                generation = MAX_GENERATION + 1;
+                return;
+            }
+
+            ++generation;
+            this->deallocateNode(new (ptr) TNode());
+        }
+
+
+        /**
+         Returns a pointer to the element that the handle refers to,
+         or nullptr if the handle is null or stale.
+        */
+        ElemType *get(Handle handle) {
+            if (!valid(handle))
+                return nullptr;
+            return &(this->m_chunks[handle.chunk()].nodes[handle.slot()].elem);
+        }
+
+        /**
+         Returns true if the handle refers to a live element of this pool.
+        */
+        bool valid(Handle handle) const {
+            return (handle.generation() & 1)
+                && handle.chunk() < m_generations.size()
+                && handle.slot() < m_generations[handle.chunk()].size()
+                && m_generations[handle.chunk()][handle.slot()] == handle.generation();
+        }
+
+        /**
+         Returns the handle of a live element of this pool.
+        */
+        Handle handleOf(const ElemType *ptr) {
+            const TNode *node = reinterpret_cast<const TNode*>(ptr);
+            size_t index = this->findChunk(node);
+            size_t slot = node - this->m_chunks[index].nodes;
+            return Handle(m_generations[index][slot], (uint8_t)index, (uint16_t)slot);
+        }
+
+
+        /**
+         Calls f(elem) on every live element of this pool,
+         which are the slots with odd generations.
+        */
+        template <typename Func>
+        void for_each_live(Func f) {
+            for (size_t index = 0; index < m_generations.size(); ++index) {
+                const std::vector<uint16_t> &gens = m_generations[index];
+                for (size_t slot = 0; slot < gens.size(); ++slot) {
+                    if (gens[slot] & 1)
+                        f(this->m_chunks[index].nodes[slot].elem);
+                }
+            }
+        }
+
+        using PoolType::chunkCount;
+        using PoolType::capacity;
+
+    private:
+        // Highest generation a handle can hold. It is odd, so it is the last live generation.
+        static const uint16_t MAX_GENERATION = (1u << Handle::GENERATION_BITS) - 1;
+
+        // Returns the generations of a chunk's slots, creating them on the chunk's first use
+        std::vector<uint16_t> &generations(size_t index) {
+            if (index >= m_generations.size())
+                m_generations.resize(index + 1);
+            if (m_generations[index].empty())
+                m_generations[index].resize(this->m_chunks[index].size, 0);
+            return m_generations[index];
+        }
+
+
+        std::vector<std::vector<uint16_t> > m_generations; // Generation of each slot of each chunk
+    };
+}
+
+#endif // DU_HANDLE_POOL_H
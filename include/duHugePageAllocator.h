@@ -0,0 +1,245 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_HUGE_PAGE_ALLOCATOR_H
+#define DU_HUGE_PAGE_ALLOCATOR_H
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "duHugePageAllocator.h requires mmap"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace Diamond {
+    /**
+     A large range of virtual address space, reserved up front with mmap,
+     that is handed out front to back.
+     The range is aligned to HUGE_PAGE_SIZE so that the kernel can back it with huge pages.
+
+     If explicitHugePages is true, the range is first mapped with MAP_HUGETLB,
+     which needs huge pages to have been set aside by the system administrator
+     (on Linux, through /proc/sys/vm/nr_hugepages) and reserves them immediately.
+     If that fails, or if explicitHugePages is false, the range is mapped lazily
+     with normal pages and marked with MADV_HUGEPAGE, so transparent huge pages
+     are used where the kernel supports them.
+
+     Freed memory is returned to the operating system. The address space of the
+     most recent allocation is reused once it is freed, as when a MemPool trims its
+     newest chunks, but that of older allocations is not, so the arena suits pools
+     whose chunks live for a long time.
+     Not thread safe.
+    */
+    class HugePageArena {
+    public:
+        static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        // 16 GB where size_t is 64 bits, 1 GB where it is 32 bits
+        static const size_t DEFAULT_RESERVE_BYTES = (size_t)1 << (sizeof(size_t) >= 8 ? 34 : 30);
+
+        /**
+         Throws std::bad_alloc if reserveBytes cannot be reserved.
+        */
+        explicit HugePageArena(size_t reserveBytes = DEFAULT_RESERVE_BYTES,
+                               bool explicitHugePages = false)
+            : m_base(nullptr),
+              m_mapping(nullptr),
+              m_mappingSize(0),
+              m_size(reserveSize(reserveBytes)),
+              m_offset(0),
+              m_explicitHugePages(false) {
+
+#ifdef MAP_HUGETLB
+            if (explicitHugePages) {
+                void *p = mmap(nullptr, m_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (p != MAP_FAILED) {
+                    // hugetlb mappings are always aligned to the huge page size
+                    m_base = m_mapping = (char*)p;
+                    m_mappingSize = m_size;
+                    m_explicitHugePages = true;
+                    return;
+                }
+            }
+#else
+            (void)explicitHugePages;
+#endif
+
+            // Over-reserve by one huge page so that the usable range can be aligned
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+            flags |= MAP_NORESERVE;
+#endif
+            m_mappingSize = m_size + HUGE_PAGE_SIZE;
+            void *p = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (p == MAP_FAILED)
+                throw std::bad_alloc();
+
+            m_mapping = (char*)p;
+            m_base = (char*)roundUp((uintptr_t)m_mapping, HUGE_PAGE_SIZE);
+
+#ifdef MADV_HUGEPAGE
+            madvise(m_base, m_size, MADV_HUGEPAGE);
+#endif
+        }
+
+        HugePageArena(const HugePageArena&) = delete;
+        HugePageArena &operator=(const HugePageArena&) = delete;
+
+        ~HugePageArena() {
+            munmap(m_mapping, m_mappingSize);
+        }
+
+
+        /**
+         Returns bytes of memory aligned to align (a power of two).
+         Throws std::bad_alloc if the reserved range is used up.
+        */
+        void *allocate(size_t bytes, size_t align) {
+            size_t start = roundUp(m_offset, align);
+            if (start > m_size || bytes > m_size - start)
+                throw std::bad_alloc();
+
+            m_offset = start + bytes;
+            return m_base + start;
+        }
+
+        /**
+         Returns the physical memory behind the whole pages in the given range
+         to the operating system. If the range is the most recent allocation,
+         its address space is handed out again by the next allocations.
+        */
+        void deallocate(void *ptr, size_t bytes) {
+            if ((char*)ptr + bytes == m_base + m_offset)
+                m_offset = (char*)ptr - m_base;
+
+            size_t pageSize = m_explicitHugePages ? HUGE_PAGE_SIZE : smallPageSize();
+
+            uintptr_t start = roundUp((uintptr_t)ptr, pageSize);
+            uintptr_t end = ((uintptr_t)ptr + bytes) & ~(uintptr_t)(pageSize - 1);
+            if (start < end)
+                madvise((void*)start, end - start, MADV_DONTNEED);
+        }
+
+
+        /**
+         Returns true if the arena is backed by explicitly reserved huge pages.
+        */
+        bool explicitHugePages() const { return m_explicitHugePages; }
+
+        /**
+         Returns the number of bytes handed out so far.
+        */
+        size_t used() const { return m_offset; }
+
+        /**
+         Returns the size of the reserved range.
+        */
+        size_t reserved() const { return m_size; }
+
+    private:
+        static size_t roundUp(size_t n, size_t align) {
+            return (n + align - 1) & ~(align - 1);
+        }
+
+        // Rounds the reservation up to whole huge pages, leaving room
+        // for the extra huge page used for alignment
+        static size_t reserveSize(size_t reserveBytes) {
+            if (reserveBytes > (size_t)-1 - 2 * HUGE_PAGE_SIZE)
+                throw std::bad_alloc();
+            return roundUp(reserveBytes, HUGE_PAGE_SIZE);
+        }
+
+        static size_t smallPageSize() {
+            static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+            return pageSize;
+        }
+
+
+        char *m_base; // Start of the usable, huge page aligned range
+        char *m_mapping; // Start of the whole mapping
+        size_t m_mappingSize;
+        size_t m_size; // Size of the usable range
+        size_t m_offset; // Offset of the first byte that has not been handed out
+        bool m_explicitHugePages;
+    };
+
+
+    /**
+     Allocator that takes its memory from a HugePageArena.
+     Meant to be used as the Allocator of MemPool for very large pools,
+     so that their chunks are contiguous and covered by few TLB entries.
+     Copies and rebound copies share the same arena, which lives as long as any of them.
+     A default constructed allocator creates a new arena with the default reservation.
+    */
+    template <typename T>
+    class HugePageAllocator {
+    public:
+        using value_type = T;
+
+        template <class U>
+        struct rebind {
+            using other = HugePageAllocator<U>;
+        };
+
+        HugePageAllocator()
+            : m_arena(std::make_shared<HugePageArena>()) {}
+
+        explicit HugePageAllocator(std::shared_ptr<HugePageArena> arena)
+            : m_arena(std::move(arena)) {}
+
+        template <class U>
+        HugePageAllocator(const HugePageAllocator<U> &other)
+            : m_arena(other.arena()) {}
+
+
+        T *allocate(size_t n) {
+            if (n > (size_t)-1 / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p, size_t n) {
+            m_arena->deallocate(p, n * sizeof(T));
+        }
+
+
+        const std::shared_ptr<HugePageArena> &arena() const { return m_arena; }
+
+    private:
+        std::shared_ptr<HugePageArena> m_arena;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const HugePageAllocator<T> &a, const HugePageAllocator<U> &b) {
+        return a.arena() == b.arena();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const HugePageAllocator<T> &a, const HugePageAllocator<U> &b) {
+        return a.arena() != b.arena();
+    }
+}
+
+#endif // DU_HUGE_PAGE_ALLOCATOR_H
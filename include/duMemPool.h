@@ -17,139 +17,731 @@
 #ifndef DU_MEM_POOL_H
 #define DU_MEM_POOL_H
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <vector>
+#include "duAlignedAllocator.h"
+#include "duBits.h"
 
 namespace Diamond {
 
+    /**
+     Usage counters of a MemPool.
+     MemPool only keeps these when DU_MEMPOOL_STATS is defined
+     before duMemPool.h is included (for example, as a compiler flag).
+     Otherwise MemPool has no stats() method and counting costs nothing.
+    */
+    struct MemPoolStats {
+        size_t liveObjects; // Nodes currently handed out
+        size_t peakLiveObjects; // Highest value liveObjects has reached
+        size_t chunksAllocated; // Chunks currently held by the pool
+        size_t bytesReserved; // Bytes in all chunks currently held by the pool
+        size_t bytesUsed; // Bytes in nodes currently handed out
+        size_t makeCount; // Total nodes handed out
+        size_t freeCount; // Total nodes returned
+        size_t growthEvents; // Total chunk allocations
+    };
+
+
     /**
      Linked list node that stores either an element of the
      list or a pointer to the next element.
+     Align raises the alignment of the node above that of T.
+     Because the size of a type is a multiple of its alignment,
+     this also pads each node out to at least Align bytes.
     */
-    template <typename T>
-    union MemNode {
+    template <typename T, size_t Align = alignof(T)>
+    union alignas(maxAlignment(maxAlignment(Align, alignof(T)), alignof(void*))) MemNode {
+        using value_type = T;
+
         MemNode() : next(nullptr) {}
 
         T elem;
-        MemNode<T> *next;
+        MemNode<T, Align> *next;
     };
 
 
     /**
-     A type-aware memory pool that allocates memory chunks of a fixed chunk size.
+     A type-aware memory pool that allocates memory in chunks.
+     The first chunk holds chunkSize elements. If maxChunkSize is greater than chunkSize,
+     each new chunk is twice the size of the last until maxChunkSize is reached,
+     so a pool with millions of elements needs few chunks and allocator calls.
+     Otherwise all chunks have the same size.
+     New chunks are not initialized: nodes are handed out from the free list of
+     recycled nodes first, and then bumped off the untouched end of a chunk,
+     so growing is O(1) and pages that are never used are never written.
+     The chunks are kept in a directory, which is walked to free them when the pool is destroyed.
+     Chunks that have become entirely free can be given back to the allocator with trim(),
+     which finds them by counting each chunk's nodes on the free list,
+     so making and freeing elements pays nothing for it.
+     trimStep() does the same work a bounded piece at a time, to fit inside a frame.
+     Likewise, the live elements can be visited with for_each_live() and destroyed
+     all at once with destroy_all(), which work out which nodes are live
+     from the free list when they are called.
      
      Note: this class does not call all destructors of the elements in its memory pool
      when it goes out of scope. It does free the memory, but the user has the responsibility
      of calling MemPool::free on every pool object that needs to be destroyed.
+
+     The node type is the value_type of Allocator, so a MemNode with a larger Align
+     can be used to over-align elements or to keep them on separate cache lines.
+     The allocator must return memory aligned for its value_type
+     (see AlignedAllocator and AlignedMemPool).
     */
-    // TODO: memory align?
     template <typename ElemType, class Allocator = std::allocator<MemNode<ElemType> > >
     class MemPool {
     public:
-        using TNode = MemNode<ElemType>;
+        using TNode = typename std::allocator_traits<Allocator>::value_type;
+
+        static_assert(std::is_same<typename TNode::value_type, ElemType>::value,
+                      "Allocator must allocate MemNodes of ElemType");
 
         MemPool(size_t chunkSize = 10, 
-                Allocator allocator = Allocator()) 
-            : m_data(nullptr), 
-              m_freeHead(nullptr),
-              m_chunkSize(chunkSize), 
+                Allocator allocator = Allocator(),
+                size_t maxChunkSize = 0) 
+            : m_freeHead(nullptr),
+              m_bumpChunk(NO_CHUNK),
+              m_lastChunk(0),
+              m_trimList(nullptr),
+              m_trimming(false),
+              m_chunkSize(chunkSize > 0 ? chunkSize : 1), 
+              m_maxChunkSize(maxChunkSize > m_chunkSize ? maxChunkSize : m_chunkSize),
+              m_lastChunkSize(0),
               m_allocator(allocator) {
             
-            m_data = allocateChunk(m_chunkSize);
-            if (m_data)
-                initChunk(m_data, m_chunkSize);
-
-            m_freeHead = m_data; // first element of free list is beginning of data chunk
+            grow(nextChunkSize());
         }
 
         ~MemPool() {
-            TNode *p;
-
             // delete all memory chunks
-            while (m_data) {
-                p = getNextChunk(m_data, m_chunkSize);
-                deallocateChunk(m_data, m_chunkSize);
-                m_data = p;
+            for (const Chunk &chunk : m_chunks) {
+                if (chunk.nodes)
+                    deallocateChunk(chunk.nodes, chunk.size);
             }
         }
 
 
         template <typename... Args>
         ElemType *make(Args&&... args) {
-            if (!m_freeHead) // this means there was a memory error
+            TNode *ret = allocateNode();
+            if (!ret)
                 return nullptr;
-            
-            if (m_freeHead->next == nullptr) {
-                // No more free space available in existing chunks, 
-                // so allocate a new chunk and point the last chunk to it.
-                TNode *newChunk = allocateChunk(m_chunkSize);
-                if (newChunk) {                    
-                    initChunk(newChunk, m_chunkSize);
-                    
-                    // The last node of the previously used chunk
-                    // points to the new chunk
-                    m_freeHead->next = newChunk;
-
-                    m_freeHead = newChunk;
+
+            try {
+                new (&(ret->elem)) ElemType(std::forward<Args>(args)...);
+            }
+            catch (...) {
+                // Otherwise the node would count as live without an element in it
+                deallocateNode(new (ret) TNode());
+                throw;
+            }
+
+            return &(ret->elem);
+        }
+
+
+        void free(ElemType *ptr) {
+            if (ptr) {
+                ptr->~ElemType();
+                deallocateNode(new (ptr) TNode());
+            }
+        }
+
+
+        /**
+         Constructs count elements from the same arguments
+         and stores pointers to them in out.
+         Nodes are taken from the free list first. The rest are carved
+         as one contiguous run off the untouched end of a chunk that is large enough
+         to hold them, which is allocated if no chunk is.
+         Returns the number of elements made, which is less than count
+         only if there was a memory error.
+         If a constructor throws, the elements already made by this call
+         are destroyed and their nodes freed before the exception is rethrown.
+        */
+        template <typename... Args>
+        size_t makeN(size_t count, ElemType **out, const Args&... args) {
+            size_t made = 0;
+
+            // Pop the whole batch off a local copy of the head,
+            // so the constructors cannot force it to be reloaded for every node
+            TNode *head = m_freeHead;
+            TNode *node = nullptr;
+            try {
+                for (;;) {
+                    while (made < count && head) {
+                        node = head;
+                        head = head->next;
+
+                        new (&(node->elem)) ElemType(args...);
+                        out[made++] = &(node->elem);
+                    }
+
+                    if (made == count || !m_trimming)
+                        break;
+
+                    // The nodes parked by the trim pass are needed after all
+                    m_freeHead = nullptr;
+                    abandonTrim();
+                    head = m_freeHead;
+                }
+            }
+            catch (...) {
+                // The node whose constructor threw goes back in front of the rest of the list
+                new (node) TNode();
+                node->next = head;
+                m_freeHead = node;
+
+                countMake(made);
+                freeN(out, made);
+                throw;
+            }
+            m_freeHead = head;
+            countMake(made);
+
+            if (made < count) {
+                size_t remaining = count - made;
+
+                // Move on to another chunk if the untouched end of the current one is too short
+                if ((m_bumpChunk == NO_CHUNK
+                     || m_chunks[m_bumpChunk].size - m_chunks[m_bumpChunk].used < remaining)
+                    && !nextBumpChunk(remaining))
+                    return made;
+
+                Chunk &chunk = m_chunks[m_bumpChunk];
+                TNode *run = chunk.nodes + chunk.used;
+                size_t constructed = 0;
+                try {
+                    for (; constructed < remaining; ++constructed) {
+                        new (&(run[constructed].elem)) ElemType(args...);
+                        out[made + constructed] = &(run[constructed].elem);
+                    }
+                }
+                catch (...) {
+                    // Nodes from the one whose constructor threw onwards stay untouched
+                    chunk.used += constructed;
+                    countMake(constructed);
+                    freeN(out, made + constructed);
+                    throw;
                 }
-                else {
+
+                chunk.used += remaining;
+                made += remaining;
+                countMake(remaining);
+            }
+
+            return made;
+        }
+
+
+        /**
+         Destroys count elements and returns them to the free list.
+         The freed nodes are linked together first and then
+         spliced onto the free list in one step.
+         Null pointers are skipped.
+        */
+        void freeN(ElemType *const *ptrs, size_t count) {
+            TNode *first = nullptr;
+            TNode *last = nullptr;
+            size_t freedCount = 0;
+
+            for (size_t i = 0; i < count; ++i) {
+                if (ptrs[i]) {
+                    ptrs[i]->~ElemType();
+
+                    TNode *freed = new (ptrs[i]) TNode();
+                    freed->next = first;
+                    first = freed;
+                    if (!last)
+                        last = freed;
+                    ++freedCount;
+                }
+            }
+
+            if (first) {
+                last->next = m_freeHead;
+                m_freeHead = first;
+                countFree(freedCount);
+            }
+        }
+
+
+        /**
+         Takes an uninitialized node off the free list, or else off the untouched end
+         of a chunk, allocating a new chunk if necessary.
+         Returns nullptr if there was a memory error.
+         No element is constructed in the node.
+        */
+        TNode *allocateNode() {
+            TNode *ret;
+            if (m_freeHead || (m_trimming && abandonTrim())) {
+                ret = m_freeHead;
+                m_freeHead = m_freeHead->next;
+            }
+            else {
+                // No recycled nodes, so bump one off the current chunk,
+                // moving on to another chunk or allocating a new one if it is used up
+                if ((m_bumpChunk == NO_CHUNK
+                     || m_chunks[m_bumpChunk].used == m_chunks[m_bumpChunk].size)
+                    && !nextBumpChunk())
                     return nullptr;
+
+                Chunk &chunk = m_chunks[m_bumpChunk];
+                ret = chunk.nodes + chunk.used++;
+            }
+            countMake(1);
+            return ret;
+        }
+
+        /**
+         Returns a node to the free list.
+         The node's element must already have been destroyed.
+        */
+        void deallocateNode(TNode *node) {
+            // The current head of the free list becomes the second element,
+            // and the freed node becomes the new head
+            node->next = m_freeHead;
+            m_freeHead = node;
+            countFree(1);
+        }
+
+        /**
+         Returns a chain of count nodes, linked through MemNode::next
+         from first to last, to the free list.
+         The chain is spliced on in one step, so this is O(1) in count.
+         The elements of the nodes must already have been destroyed.
+        */
+        void deallocateNodes(TNode *first, TNode *last, size_t count) {
+            last->next = m_freeHead;
+            m_freeHead = first;
+            countFree(count);
+        }
+
+
+        /**
+         Gives chunks that have no live elements back to the allocator
+         in one full pass, finishing any pass started by trimStep() first.
+         A chunk has no live elements when every node that has been bumped off it
+         is on the free list, so this sorts the free list by chunk to count
+         each chunk's free nodes. The cost grows with the length of the free list.
+         Returns the number of chunks released.
+        */
+        size_t trim() {
+            size_t count = m_trimming ? trimStep((size_t)-1) : 0;
+            return count + trimStep((size_t)-1);
+        }
+
+        /**
+         Does the work of trim() a piece at a time, so that it can be spread over frames.
+         Each call sorts at most maxNodes nodes of the free list by chunk.
+         A pass starts by taking over the whole free list, and the call that
+         sorts its last node releases the chunks whose nodes were all free
+         when the pass started and relinks the nodes of the others,
+         which costs O(number of chunks) more.
+         Nodes freed during the pass are reused first. If they run out,
+         making an element abandons the pass and takes the parked nodes back,
+         so trimming never makes the pool grow.
+         Returns the number of chunks released by this call.
+        */
+        size_t trimStep(size_t maxNodes) {
+            if (!m_trimming) {
+                m_trimList = m_freeHead;
+                m_freeHead = nullptr;
+                m_trimBuckets.assign(m_chunks.size(), TrimBucket{nullptr, nullptr, 0});
+                m_trimming = true;
+            }
+
+            for (size_t n = 0; n < maxNodes && m_trimList; ++n) {
+                TNode *node = m_trimList;
+                m_trimList = node->next;
+
+                TrimBucket &bucket = m_trimBuckets[findChunk(node)];
+                node->next = bucket.first;
+                bucket.first = node;
+                if (!bucket.last)
+                    bucket.last = node;
+                ++bucket.count;
+            }
+
+            if (m_trimList)
+                return 0;
+
+            m_trimming = false;
+            size_t count = 0;
+
+            for (size_t i = 0; i < m_chunks.size(); ++i) {
+                // Chunks added during the pass have no bucket and parked no nodes
+                const TrimBucket bucket = i < m_trimBuckets.size()
+                                          ? m_trimBuckets[i] : TrimBucket{nullptr, nullptr, 0};
+
+                if (m_chunks[i].nodes && bucket.count == m_chunks[i].used) {
+                    releaseChunk(i);
+                    ++count;
+                }
+                else if (bucket.first) {
+                    bucket.last->next = m_freeHead;
+                    m_freeHead = bucket.first;
                 }
             }
 
-            TNode *ret = m_freeHead;
-            m_freeHead = m_freeHead->next;
+            m_trimBuckets.clear();
+            return count;
+        }
 
-            new (&(ret->elem)) ElemType(std::forward<Args>(args)...);
+        /**
+         Returns true while a pass started by trimStep() is in progress.
+        */
+        bool trimming() const { return m_trimming; }
+
+
+        /**
+         Calls f(elem) on every live element of this pool.
+         Every node below the untouched end of a chunk is live unless it is free,
+         so this first walks the free list to mark the free nodes of each chunk in a bitmap,
+         and then scans the bitmaps a word at a time.
+         f must not make or free elements of this pool.
+        */
+        template <typename Func>
+        void for_each_live(Func f) {
+            std::vector<std::vector<uint64_t> > freeBits(m_chunks.size());
+            for (size_t i = 0; i < m_chunks.size(); ++i)
+                freeBits[i].assign((m_chunks[i].used + 63) / 64, 0);
+
+            auto markFree = [this, &freeBits](const TNode *list) {
+                for (const TNode *node = list; node; node = node->next) {
+                    size_t index = findChunk(node);
+                    size_t i = node - m_chunks[index].nodes;
+                    freeBits[index][i / 64] |= (uint64_t)1 << (i % 64);
+                }
+            };
+
+            // Nodes parked by a trim pass are free too
+            markFree(m_freeHead);
+            markFree(m_trimList);
+            for (const TrimBucket &bucket : m_trimBuckets)
+                markFree(bucket.first);
+
+            for (size_t index : m_chunkOrder) {
+                Chunk &chunk = m_chunks[index];
+
+                for (size_t word = 0; word < freeBits[index].size(); ++word) {
+                    uint64_t bits = ~freeBits[index][word];
+                    if ((word + 1) * 64 > chunk.used)
+                        bits &= ((uint64_t)1 << (chunk.used % 64)) - 1; // nodes past the untouched end
+
+                    while (bits) {
+                        size_t i = word * 64 + Bits::countTrailingZeros(bits);
+                        f(chunk.nodes[i].elem);
+                        bits &= bits - 1; // clear lowest set bit
+                    }
+                }
+            }
+        }
 
-            return &(ret->elem);
+        /**
+         Calls the destructor of every live element and then clears the pool.
+        */
+        void destroy_all() {
+            for_each_live([](ElemType &elem) { elem.~ElemType(); });
+            clear();
         }
 
+        /**
+         Makes every node of every chunk free without calling any destructors.
+         All pointers to elements of this pool become invalid. Chunks are kept.
+         The nodes are not relinked: the free list is emptied and each chunk
+         is marked untouched again, to be bumped from afterwards.
+        */
+        void clear() {
+            m_freeHead = nullptr;
+            m_bumpChunk = NO_CHUNK;
+
+            m_trimList = nullptr;
+            m_trimBuckets.clear();
+            m_trimming = false;
+
+            for (size_t index : m_chunkOrder) {
+                Chunk &chunk = m_chunks[index];
+                chunk.used = 0;
+            }
 
-        void free(ElemType *ptr) {
-            if (ptr) {
-                ptr->~ElemType();
+            countClear();
+        }
+
+
+        /**
+         Allocates a chunk, if needed, so that this pool can hold at least n elements in total.
+         Then making elements does not call the allocator until n are live.
+         If prefault is true, every page of every chunk is also written to,
+         so that the first use of a node does not take a page fault.
+         Returns false if there was a memory error.
+        */
+        bool reserve(size_t n, bool prefault = false) {
+            size_t total = capacity();
+            if (total < n) {
+                size_t size = nextChunkSize();
+                if (size < n - total)
+                    size = n - total;
+
+                if (!grow(size))
+                    return false;
+            }
 
-                // The current head of the free list becomes the second element,
-                // and the freed pointer becomes the new head
-                TNode *freed = new (ptr) TNode();
-                freed->next = m_freeHead;
-                m_freeHead = freed;
+            if (prefault) {
+                for (const Chunk &chunk : m_chunks) {
+                    if (chunk.nodes)
+                        prefaultChunk(chunk.nodes, chunk.size);
+                }
             }
+
+            return true;
         }
 
+
+        /**
+         Returns the number of chunks held by this pool.
+        */
+        size_t chunkCount() const { return m_chunkOrder.size(); }
+
+        /**
+         Returns the total number of elements that fit in this pool's chunks.
+        */
+        size_t capacity() const {
+            size_t total = 0;
+            for (const Chunk &chunk : m_chunks)
+                total += chunk.size;
+            return total;
+        }
+
+#ifdef DU_MEMPOOL_STATS
+        /**
+         Returns this pool's usage counters.
+        */
+        MemPoolStats stats() const {
+            MemPoolStats stats = m_stats;
+            stats.bytesUsed = stats.liveObjects * sizeof(TNode);
+            return stats;
+        }
+#endif
+
     protected:
+        static const size_t NO_CHUNK = (size_t)-1;
+
+        // Directory entry of a chunk. Released chunks have null nodes and size 0,
+        // and their entries are reused by the next chunks that are allocated.
+        struct Chunk {
+            TNode *nodes;
+            size_t size;
+            size_t used; // Number of nodes at the start of the chunk that have ever been handed out
+        };
+
+
+        // Free nodes of one chunk, sorted out of the free list by a trim pass
+        struct TrimBucket {
+            TNode *first;
+            TNode *last;
+            size_t count;
+        };
+
+
+        // Gives the nodes parked by the trim pass in progress back to the free list
+        // and ends the pass. Must only be called when the free list is empty.
+        // Returns true if the free list is not empty afterwards.
+        bool abandonTrim() {
+            m_freeHead = m_trimList;
+            for (const TrimBucket &bucket : m_trimBuckets) {
+                if (bucket.first) {
+                    bucket.last->next = m_freeHead;
+                    m_freeHead = bucket.first;
+                }
+            }
+
+            m_trimList = nullptr;
+            m_trimBuckets.clear();
+            m_trimming = false;
+
+            return m_freeHead != nullptr;
+        }
+
+        // Allocates a new chunk of the given size and starts bumping nodes off it.
+        // Returns false if there was a memory error.
+        bool grow(size_t size) {
+            if (!addChunk(size))
+                return false;
+
+            m_bumpChunk = m_lastChunk;
+            return true;
+        }
+
+        // Moves the bump pointer to the first chunk, by address, that has at least
+        // count untouched nodes, growing the pool by a chunk that holds them if there is none.
+        // Returns false if there was a memory error.
+        bool nextBumpChunk(size_t count = 1) {
+            for (size_t index : m_chunkOrder) {
+                if (m_chunks[index].size - m_chunks[index].used >= count) {
+                    m_bumpChunk = index;
+                    return true;
+                }
+            }
+
+            size_t size = nextChunkSize();
+            return grow(size > count ? size : count);
+        }
+
+        // Allocates a chunk of the given size and records it in the directory.
+        // Returns nullptr if there was a memory error.
+        // Afterwards m_lastChunk is the index of the new chunk.
+        TNode *addChunk(size_t size) {
+            m_chunks.reserve(m_chunks.size() + 1);
+            m_chunkOrder.reserve(m_chunkOrder.size() + 1);
+
+            TNode *chunk = allocateChunk(size);
+            if (!chunk)
+                return nullptr;
+
+            size_t index = 0;
+            while (index < m_chunks.size() && m_chunks[index].nodes)
+                ++index;
+            if (index == m_chunks.size())
+                m_chunks.push_back(Chunk());
+
+            m_chunks[index] = Chunk{chunk, size, 0};
+            m_chunkOrder.insert(std::upper_bound(m_chunkOrder.begin(), m_chunkOrder.end(), chunk,
+                                                 [this](const TNode *node, size_t i) {
+                                                     return (uintptr_t)node < (uintptr_t)m_chunks[i].nodes;
+                                                 }),
+                                index);
+
+            m_lastChunk = index;
+            m_lastChunkSize = size;
+            countChunk(size);
+
+            return chunk;
+        }
+
+        // Deallocates a chunk whose nodes are no longer on the free list
+        void releaseChunk(size_t index) {
+            Chunk &chunk = m_chunks[index];
+
+            deallocateChunk(chunk.nodes, chunk.size);
+            countRelease(chunk.size);
+
+            m_chunkOrder.erase(std::find(m_chunkOrder.begin(), m_chunkOrder.end(), index));
+            chunk = Chunk{nullptr, 0, 0};
+
+            if (m_bumpChunk == index)
+                m_bumpChunk = NO_CHUNK;
+        }
+
+        // Returns the directory index of the chunk that holds the given node
+        size_t findChunk(const TNode *node) {
+            // Consecutive lookups usually hit the same chunk
+            const Chunk &last = m_chunks[m_lastChunk];
+            if ((uintptr_t)node >= (uintptr_t)last.nodes
+                && (uintptr_t)node < (uintptr_t)(last.nodes + last.size))
+                return m_lastChunk;
+
+            // The chunk is the last one that starts at or before the node
+            auto it = std::upper_bound(m_chunkOrder.begin(), m_chunkOrder.end(), node,
+                                       [this](const TNode *n, size_t i) {
+                                           return (uintptr_t)n < (uintptr_t)m_chunks[i].nodes;
+                                       });
+            m_lastChunk = *(it - 1);
+            return m_lastChunk;
+        }
+
+        size_t nextChunkSize() const {
+            if (m_lastChunkSize == 0)
+                return m_chunkSize;
+
+            size_t size = 2 * m_lastChunkSize;
+            return size < m_maxChunkSize ? size : m_maxChunkSize;
+        }
+
         TNode *allocateChunk(size_t chunkSize) {
-            return m_allocator.allocate(chunkSize + 1); // + 1 to hold pointer to next chunk
+            return m_allocator.allocate(chunkSize);
         }
 
         void deallocateChunk(TNode *chunk, size_t chunkSize) {
-            m_allocator.deallocate(chunk, chunkSize + 1);
+            m_allocator.deallocate(chunk, chunkSize);
+        }
+
+        // Writes one byte in every page of a chunk back to itself,
+        // which makes the OS map the page without changing its contents
+        static void prefaultChunk(TNode *chunk, size_t chunkSize) {
+            const size_t stride = 4096; // smallest page size we target
+            volatile char *bytes = reinterpret_cast<volatile char*>(chunk);
+            size_t size = chunkSize * sizeof(TNode);
+            for (size_t i = 0; i < size; i += stride)
+                bytes[i] = bytes[i];
+            bytes[size - 1] = bytes[size - 1];
         }
 
-        void initChunk(TNode *chunk, size_t chunkSize) {
-            // point all free list elements to the next adjacent space in the chunk
-            TNode *p = chunk;
-            while (p < chunk + chunkSize) {
-                p->next = p + 1;
-                ++p;
-            }
 
-            // the last element does not have a next
-            p->next = nullptr;
+#ifdef DU_MEMPOOL_STATS
+        void countMake(size_t count) {
+            m_stats.makeCount += count;
+            m_stats.liveObjects += count;
+            if (m_stats.liveObjects > m_stats.peakLiveObjects)
+                m_stats.peakLiveObjects = m_stats.liveObjects;
         }
 
-        // Get pointer to the next chunk in a series of chunks
-        TNode *getNextChunk(TNode *startChunk, size_t chunkSize) const {
-            return (startChunk + chunkSize)->next;
+        void countFree(size_t count) {
+            m_stats.freeCount += count;
+            m_stats.liveObjects -= count;
         }
 
+        void countChunk(size_t size) {
+            ++m_stats.chunksAllocated;
+            ++m_stats.growthEvents;
+            m_stats.bytesReserved += size * sizeof(TNode);
+        }
+
+        void countRelease(size_t size) {
+            --m_stats.chunksAllocated;
+            m_stats.bytesReserved -= size * sizeof(TNode);
+        }
 
-        TNode *m_data; // Pointer to first memory chunk
-        TNode *m_freeHead; // Pointer to first element of free list
+        void countClear() {
+            countFree(m_stats.liveObjects);
+        }
 
-        size_t m_chunkSize;
+        MemPoolStats m_stats = MemPoolStats();
+#else
+        void countMake(size_t) {}
+        void countFree(size_t) {}
+        void countChunk(size_t) {}
+        void countRelease(size_t) {}
+        void countClear() {}
+#endif
+
+
+        std::vector<Chunk> m_chunks; // Directory of all memory chunks
+        std::vector<size_t> m_chunkOrder; // Indices of held chunks, sorted by address
+        TNode *m_freeHead; // Pointer to first element of free list of recycled nodes
+        size_t m_bumpChunk; // Index of the chunk that untouched nodes are taken from, or NO_CHUNK
+        size_t m_lastChunk; // Index of the chunk that was last allocated or looked up
+
+        std::vector<TrimBucket> m_trimBuckets; // Free nodes sorted by chunk so far in the trim pass
+        TNode *m_trimList; // Free nodes not yet sorted in the trim pass
+        bool m_trimming; // Whether a trim pass is in progress
+
+        size_t m_chunkSize; // Size of the first chunk
+        size_t m_maxChunkSize; // Size that chunk growth stops doubling at
+        size_t m_lastChunkSize; // Size of the most recently allocated chunk
         Allocator m_allocator;
     };
+
+
+    /**
+     MemPool whose elements are each aligned to, and padded out to, Align bytes.
+     The default of one cache line keeps objects that are used by different threads
+     from sharing a cache line.
+    */
+    template <typename ElemType, size_t Align = CACHE_LINE_SIZE>
+    using AlignedMemPool = MemPool<ElemType, AlignedAllocator<MemNode<ElemType, Align> > >;
 }
 
 #endif // DU_MEM_POOL_H
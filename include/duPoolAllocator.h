@@ -0,0 +1,208 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_POOL_ALLOCATOR_H
+#define DU_POOL_ALLOCATOR_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "duMemPool.h"
+
+namespace Diamond {
+    /**
+     The MemPools behind a family of PoolAllocators, one for every
+     distinct object size and alignment that has been allocated.
+     Shared by all copies and rebound copies of a PoolAllocator.
+     chunkSize and maxChunkSize are passed on to each MemPool, so by default
+     a pool's chunks grow from DEFAULT_CHUNK_SIZE to DEFAULT_MAX_CHUNK_SIZE nodes.
+    */
+    class PoolAllocatorState {
+    public:
+        template <size_t Size, size_t Align>
+        using Storage = typename std::aligned_storage<Size, Align>::type;
+
+        template <size_t Size, size_t Align>
+        using PoolType = MemPool<Storage<Size, Align> >;
+
+        static const size_t DEFAULT_CHUNK_SIZE = 64;
+        static const size_t DEFAULT_MAX_CHUNK_SIZE = 65536;
+
+        explicit PoolAllocatorState(size_t chunkSize = DEFAULT_CHUNK_SIZE,
+                                    size_t maxChunkSize = DEFAULT_MAX_CHUNK_SIZE)
+            : m_chunkSize(chunkSize),
+              m_maxChunkSize(maxChunkSize) {}
+
+        PoolAllocatorState(const PoolAllocatorState&) = delete;
+        PoolAllocatorState &operator=(const PoolAllocatorState&) = delete;
+
+
+        /**
+         Returns the pool for objects of the given size and alignment,
+         creating it on first use.
+        */
+        template <size_t Size, size_t Align>
+        PoolType<Size, Align> *pool() {
+            for (auto &entry : m_pools) {
+                if (entry.size == Size && entry.align == Align)
+                    return &static_cast<Holder<Size, Align>*>(entry.holder.get())->pool;
+            }
+
+            Holder<Size, Align> *holder = new Holder<Size, Align>(m_chunkSize, m_maxChunkSize);
+            m_pools.push_back(Entry{Size, Align, std::unique_ptr<HolderBase>(holder)});
+            return &holder->pool;
+        }
+
+        /**
+         Returns the number of distinct pools created so far.
+        */
+        size_t poolCount() const { return m_pools.size(); }
+
+    private:
+        struct HolderBase {
+            virtual ~HolderBase() {}
+        };
+
+        template <size_t Size, size_t Align>
+        struct Holder : HolderBase {
+            Holder(size_t chunkSize, size_t maxChunkSize)
+                : pool(chunkSize, std::allocator<MemNode<Storage<Size, Align> > >(), maxChunkSize) {}
+
+            PoolType<Size, Align> pool;
+        };
+
+        struct Entry {
+            size_t size;
+            size_t align;
+            std::unique_ptr<HolderBase> holder;
+        };
+
+
+        std::vector<Entry> m_pools;
+
+        size_t m_chunkSize;
+        size_t m_maxChunkSize;
+    };
+
+
+    /**
+     Allocator for standard containers that serves single objects from a MemPool.
+     Node based containers such as std::list, std::map and std::unordered_map
+     allocate their nodes one at a time through a rebound copy of this allocator,
+     so each node type gets a pool sized for it.
+     Requests for more than one object (such as bucket arrays) go to std::allocator.
+
+     Copies and rebound copies share their pools and compare equal.
+     A default constructed allocator creates a new set of pools.
+     Like MemPool, this class is not thread safe, and memory from the pools
+     is only given back to the system when the last copy is destroyed.
+    */
+    template <typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template <class U>
+        struct rebind {
+            using other = PoolAllocator<U>;
+        };
+
+        PoolAllocator()
+            : m_state(std::make_shared<PoolAllocatorState>()),
+              m_pool(nullptr) {}
+
+        explicit PoolAllocator(size_t chunkSize,
+                               size_t maxChunkSize = PoolAllocatorState::DEFAULT_MAX_CHUNK_SIZE)
+            : m_state(std::make_shared<PoolAllocatorState>(chunkSize, maxChunkSize)),
+              m_pool(nullptr) {}
+
+        explicit PoolAllocator(std::shared_ptr<PoolAllocatorState> state)
+            : m_state(std::move(state)),
+              m_pool(nullptr) {}
+
+        PoolAllocator(const PoolAllocator &other)
+            : m_state(other.m_state),
+              m_pool(other.m_pool) {}
+
+        template <class U>
+        PoolAllocator(const PoolAllocator<U> &other)
+            : m_state(other.state()),
+              m_pool(nullptr) {}
+
+        PoolAllocator &operator=(const PoolAllocator &other) {
+            m_state = other.m_state;
+            m_pool = other.m_pool;
+            return *this;
+        }
+
+
+        T *allocate(size_t n) {
+            if (n != 1)
+                return std::allocator<T>().allocate(n);
+
+            void *p = pool()->allocateNode();
+            if (!p)
+                throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T *p, size_t n) {
+            if (n != 1) {
+                std::allocator<T>().deallocate(p, n);
+                return;
+            }
+
+            using TNode = typename PoolAllocatorState::PoolType<sizeof(T), alignof(T)>::TNode;
+            pool()->deallocateNode(new (p) TNode());
+        }
+
+
+        const std::shared_ptr<PoolAllocatorState> &state() const { return m_state; }
+
+    private:
+        // The pool is looked up on first use rather than on construction,
+        // and no declaration in the class depends on sizeof(T),
+        // so that T may still be incomplete when the allocator is created.
+        template <class U = T>
+        PoolAllocatorState::PoolType<sizeof(U), alignof(U)> *pool() {
+            using PoolType = PoolAllocatorState::PoolType<sizeof(U), alignof(U)>;
+            if (!m_pool)
+                m_pool = m_state->pool<sizeof(U), alignof(U)>();
+            return static_cast<PoolType*>(m_pool);
+        }
+
+
+        std::shared_ptr<PoolAllocatorState> m_state;
+        void *m_pool; // Cached pool for T, or nullptr until first needed
+    };
+
+    template <typename T, typename U>
+    bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) {
+        return a.state() == b.state();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) {
+        return a.state() != b.state();
+    }
+}
+
+#endif // DU_POOL_ALLOCATOR_H
@@ -0,0 +1,248 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_POOL_DIRECTORY_H
+#define DU_POOL_DIRECTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include "duAlignedAllocator.h"
+#include "duCompactDumbPtr.h"
+
+namespace Diamond {
+    /**
+     Process-wide map from every page of registered memory to a DumbDeleterRegistry index,
+     so that the pool that owns any pooled pointer can be found from the pointer alone.
+     The map is a radix tree over the page number of a 48 bit address,
+     with three levels of 12 bits each, like a page table. Interior nodes and leaves
+     are allocated the first time a page under them is registered and are never freed,
+     so looking up a page is three dependent loads and takes no lock.
+     Inserting and erasing ranges is serialized by a mutex.
+
+     A page can only belong to one range, so registered ranges must be page aligned
+     and must not share pages (DirectoryAllocator takes care of this).
+     Addresses at or above 2^48, such as those of 5-level paging or tagged pointers,
+     cannot be registered and are never found.
+    */
+    class PoolDirectory {
+    public:
+        static const unsigned PAGE_SHIFT = 12;
+        static const size_t PAGE_BYTES = (size_t)1 << PAGE_SHIFT;
+
+        static const unsigned LEVEL_BITS = 12;
+        static const size_t LEVEL_SIZE = (size_t)1 << LEVEL_BITS;
+        static const unsigned ADDRESS_BITS = PAGE_SHIFT + 3 * LEVEL_BITS; // 48
+
+        /**
+         Returns true if every byte of [start, start + bytes) is below 2^48,
+         so that the range can be registered.
+        */
+        static bool covers(const void *start, size_t bytes) {
+            const uint64_t limit = (uint64_t)1 << ADDRESS_BITS;
+            uint64_t address = (uint64_t)(uintptr_t)start;
+            return address <= limit && (uint64_t)bytes <= limit - address;
+        }
+
+        /**
+         Maps every page in [start, start + bytes) to deleterIndex.
+         Throws std::out_of_range if the directory does not cover the range.
+        */
+        static void insert(const void *start, size_t bytes, uint16_t deleterIndex) {
+            if (!covers(start, bytes))
+                throw std::out_of_range("PoolDirectory: range is not below 2^48");
+
+            Root &root = instance();
+            std::lock_guard<std::mutex> lock(root.mutex);
+
+            for (uintptr_t page = pageOf(start); page < pageOf(start) + pageCount(bytes); ++page)
+                leafFor(root, page)->entries[page % LEVEL_SIZE].store(deleterIndex, std::memory_order_relaxed);
+        }
+
+        /**
+         Unmaps every page in [start, start + bytes).
+        */
+        static void erase(const void *start, size_t bytes) {
+            if (!covers(start, bytes))
+                return;
+
+            Root &root = instance();
+            std::lock_guard<std::mutex> lock(root.mutex);
+
+            for (uintptr_t page = pageOf(start); page < pageOf(start) + pageCount(bytes); ++page)
+                leafFor(root, page)->entries[page % LEVEL_SIZE].store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         Returns the deleter index of the page that ptr is in,
+         or 0 if the page is not registered.
+        */
+        static uint16_t find(const void *ptr) {
+            if ((uint64_t)(uintptr_t)ptr >> ADDRESS_BITS)
+                return 0;
+
+            uintptr_t page = pageOf(ptr);
+
+            Middle *middle = instance().middles[page >> (2 * LEVEL_BITS)].load(std::memory_order_acquire);
+            if (!middle)
+                return 0;
+
+            Leaf *leaf = middle->leaves[(page >> LEVEL_BITS) % LEVEL_SIZE].load(std::memory_order_acquire);
+            if (!leaf)
+                return 0;
+
+            return leaf->entries[page % LEVEL_SIZE].load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Leaf {
+            std::atomic<uint16_t> entries[LEVEL_SIZE];
+        };
+
+        struct Middle {
+            std::atomic<Leaf*> leaves[LEVEL_SIZE];
+        };
+
+        struct Root {
+            std::atomic<Middle*> middles[LEVEL_SIZE];
+            std::mutex mutex;
+        };
+
+        static Root &instance() {
+            // Zero initialized like the registry table
+            static Root root;
+            return root;
+        }
+
+        static uintptr_t pageOf(const void *ptr) {
+            return (uintptr_t)ptr >> PAGE_SHIFT;
+        }
+
+        static size_t pageCount(size_t bytes) {
+            return (bytes + PAGE_BYTES - 1) >> PAGE_SHIFT;
+        }
+
+        // Returns the leaf that maps the given page, creating nodes on the way.
+        // Must be called with the mutex held.
+        static Leaf *leafFor(Root &root, uintptr_t page) {
+            std::atomic<Middle*> &middleSlot = root.middles[page >> (2 * LEVEL_BITS)];
+            Middle *middle = middleSlot.load(std::memory_order_relaxed);
+            if (!middle) {
+                middle = new Middle();
+                middleSlot.store(middle, std::memory_order_release);
+            }
+
+            std::atomic<Leaf*> &leafSlot = middle->leaves[(page >> LEVEL_BITS) % LEVEL_SIZE];
+            Leaf *leaf = leafSlot.load(std::memory_order_relaxed);
+            if (!leaf) {
+                leaf = new Leaf();
+                leafSlot.store(leaf, std::memory_order_release);
+            }
+
+            return leaf;
+        }
+    };
+
+
+    /**
+     Frees a pointer made by any pool whose chunks are registered in the PoolDirectory,
+     such as the pool of a DirectoryPoolManager, without knowing which pool that is.
+     Returns false, and does nothing, if ptr is not in a registered page.
+     The same threading rules apply as for freeing through the pool directly.
+    */
+    inline bool pool_free(void *ptr) {
+        uint16_t index = ptr ? PoolDirectory::find(ptr) : 0;
+        if (!index)
+            return false;
+
+        DumbDeleterRegistry::free(index, ptr);
+        return true;
+    }
+
+
+    /**
+     Allocator that registers the memory it allocates in the PoolDirectory
+     under the given DumbDeleterRegistry index, and unregisters it when it is deallocated.
+     Each allocation is page aligned and padded to whole pages so that no page
+     is shared with other memory, which suits the large chunks of a MemPool.
+     Memory that the directory cannot cover is given back, and std::bad_alloc is thrown.
+    */
+    template <typename T>
+    class DirectoryAllocator {
+    public:
+        using value_type = T;
+
+        template <class U>
+        struct rebind {
+            using other = DirectoryAllocator<U>;
+        };
+
+        explicit DirectoryAllocator(uint16_t deleterIndex) : m_deleterIndex(deleterIndex) {}
+
+        template <class U>
+        DirectoryAllocator(const DirectoryAllocator<U> &other) : m_deleterIndex(other.deleterIndex()) {}
+
+
+        T *allocate(size_t n) {
+            if (n > ((size_t)-1 - PoolDirectory::PAGE_BYTES) / sizeof(T))
+                throw std::bad_alloc();
+
+            size_t bytes = paddedSize(n);
+            void *p = PageAllocator().allocate(bytes);
+            if (!PoolDirectory::covers(p, bytes)) {
+                PageAllocator().deallocate((unsigned char*)p, bytes);
+                throw std::bad_alloc();
+            }
+
+            PoolDirectory::insert(p, bytes, m_deleterIndex);
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T *p, size_t n) {
+            size_t bytes = paddedSize(n);
+            PoolDirectory::erase(p, bytes);
+            PageAllocator().deallocate((unsigned char*)p, bytes);
+        }
+
+
+        uint16_t deleterIndex() const { return m_deleterIndex; }
+
+    private:
+        using PageAllocator = AlignedAllocator<unsigned char, maxAlignment(PoolDirectory::PAGE_BYTES, alignof(T))>;
+
+        static size_t paddedSize(size_t n) {
+            return (n * sizeof(T) + PoolDirectory::PAGE_BYTES - 1) & ~(PoolDirectory::PAGE_BYTES - 1);
+        }
+
+
+        uint16_t m_deleterIndex;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const DirectoryAllocator<T> &a, const DirectoryAllocator<U> &b) {
+        return a.deleterIndex() == b.deleterIndex();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const DirectoryAllocator<T> &a, const DirectoryAllocator<U> &b) {
+        return a.deleterIndex() != b.deleterIndex();
+    }
+}
+
+#endif // DU_POOL_DIRECTORY_H
@@ -17,6 +17,8 @@
 #ifndef DU_POOL_MANAGER_H
 #define DU_POOL_MANAGER_H
 
+#include <type_traits>
+#include <utility>
 #include "duDumbPtr.h"
 #include "duMemPool.h"
 
@@ -25,18 +27,21 @@ namespace Diamond {
     /**
      Deleter that is constructed with a memory pool
      and, when called, frees the given pointer from the pool.
+     A default constructed deleter has no pool and
+     must be assigned one before it is called.
     */
     template <class PoolType, typename ElemType>
     class PoolDeleter {
     public:
-        PoolDeleter(PoolType &pool) : m_pool(pool) {}
+        PoolDeleter() : m_pool(nullptr) {}
+        PoolDeleter(PoolType &pool) : m_pool(&pool) {}
 
         void operator() (ElemType *ptr) const {
-            m_pool.free(ptr);
+            m_pool->free(ptr);
         }
 
     private:
-        PoolType &m_pool;
+        PoolType *m_pool;
     };
 
     /**
@@ -58,15 +63,19 @@ namespace Diamond {
     /**
      Memory pool container that generates smart pointers of
      the pooled object with a pool deleter.
+     PoolType may be any pool with the constructor and methods of MemPool,
+     such as RemoteFreeMemPool when pointers are released by other threads.
     */
     template <typename ElemType,
               class PtrType,
-              class Allocator = std::allocator<MemNode<ElemType> > >
+              class Allocator = std::allocator<MemNode<ElemType> >,
+              class PoolType = MemPool<ElemType, Allocator> >
     class PoolManager {
     public:
         PoolManager(size_t chunkSize = 10,
-                    Allocator allocator = Allocator())
-            : m_pool(chunkSize, allocator),
+                    Allocator allocator = Allocator(),
+                    size_t maxChunkSize = 0)
+            : m_pool(chunkSize, allocator, maxChunkSize),
               m_deleter(m_pool) {}
 
 
@@ -77,21 +86,80 @@ namespace Diamond {
         }
 
 
+        /**
+         Constructs count elements from the same arguments
+         and stores pointers to them in out.
+         Returns the number of elements made.
+         See MemPool::makeN.
+        */
+        template <typename... Args>
+        size_t makeN(size_t count, PtrType *out, const Args&... args) {
+            ElemType *raw[BATCH_SIZE];
+            size_t made = 0;
+
+            while (made < count) {
+                size_t n = count - made < BATCH_SIZE ? count - made : BATCH_SIZE;
+                size_t batchMade = m_pool.makeN(n, raw, args...);
+
+                for (size_t i = 0; i < batchMade; ++i)
+                    out[made++] = PtrType(raw[i], m_deleter);
+
+                if (batchMade < n)
+                    break;
+            }
+
+            return made;
+        }
+
+
+        /**
+         Frees count pointers made by this manager in one batch.
+         Each pointer is released first, so PtrType must have a release() method
+         (like std::unique_ptr). Shared pointers cannot give up ownership,
+         so freeN does not compile for them.
+        */
+        void freeN(PtrType *ptrs, size_t count) {
+            static_assert(decltype(hasRelease<PtrType>(0))::value,
+                          "PoolManager::freeN requires a PtrType with release(), like std::unique_ptr");
+
+            ElemType *raw[BATCH_SIZE];
+
+            for (size_t done = 0; done < count; done += BATCH_SIZE) {
+                size_t n = count - done < BATCH_SIZE ? count - done : BATCH_SIZE;
+                for (size_t i = 0; i < n; ++i)
+                    raw[i] = ptrs[done + i].release();
+
+                m_pool.freeN(raw, n);
+            }
+        }
+
+
     protected:
-        MemPool<ElemType, Allocator> m_pool;
-        PoolDeleter<MemPool<ElemType, Allocator>, ElemType> m_deleter;
+        static const size_t BATCH_SIZE = 64;
+
+        template <class P>
+        static auto hasRelease(int) -> decltype(std::declval<P&>().release(), std::true_type());
+
+        template <class P>
+        static std::false_type hasRelease(...);
+
+
+        PoolType m_pool;
+        PoolDeleter<PoolType, ElemType> m_deleter;
     };
 
     /**
      Like PoolManager but for dumb pointers.
     */
     template <typename ElemType,
-              class Allocator = std::allocator<MemNode<ElemType> > >
+              class Allocator = std::allocator<MemNode<ElemType> >,
+              class PoolType = MemPool<ElemType, Allocator> >
     class DumbPoolManager {
     public:
         DumbPoolManager(size_t chunkSize = 10,
-                        Allocator allocator = Allocator())
-            : m_pool(chunkSize, allocator),
+                        Allocator allocator = Allocator(),
+                        size_t maxChunkSize = 0)
+            : m_pool(chunkSize, allocator, maxChunkSize),
               m_deleter(m_pool) {}
 
         template <typename... Args>
@@ -100,9 +168,57 @@ namespace Diamond {
                                      &m_deleter);
         }
 
+
+        /**
+         Constructs count elements from the same arguments
+         and stores pointers to them in out.
+         Returns the number of elements made.
+         See MemPool::makeN.
+        */
+        template <typename... Args>
+        size_t makeN(size_t count, DumbPtr<ElemType> *out, const Args&... args) {
+            ElemType *raw[BATCH_SIZE];
+            size_t made = 0;
+
+            while (made < count) {
+                size_t n = count - made < BATCH_SIZE ? count - made : BATCH_SIZE;
+                size_t batchMade = m_pool.makeN(n, raw, args...);
+
+                for (size_t i = 0; i < batchMade; ++i)
+                    out[made++] = DumbPtr<ElemType>(raw[i], &m_deleter);
+
+                if (batchMade < n)
+                    break;
+            }
+
+            return made;
+        }
+
+
+        /**
+         Frees count pointers made by this manager in one batch
+         and sets them to null.
+        */
+        void freeN(DumbPtr<ElemType> *ptrs, size_t count) {
+            ElemType *raw[BATCH_SIZE];
+
+            for (size_t done = 0; done < count; done += BATCH_SIZE) {
+                size_t n = count - done < BATCH_SIZE ? count - done : BATCH_SIZE;
+                for (size_t i = 0; i < n; ++i) {
+                    raw[i] = ptrs[done + i].get();
+                    ptrs[done + i] = nullptr;
+                }
+
+                m_pool.freeN(raw, n);
+            }
+        }
+
     protected:
-        MemPool<ElemType, Allocator> m_pool;
-        DumbPoolDeleter<MemPool<ElemType, Allocator>, ElemType> m_deleter;
+        static const size_t BATCH_SIZE = 64;
+
+
+        PoolType m_pool;
+        DumbPoolDeleter<PoolType, ElemType> m_deleter;
     };
 }
 
@@ -0,0 +1,198 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_POOL_REF_H
+#define DU_POOL_REF_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "duPoolManager.h"
+
+namespace Diamond {
+
+    /**
+     Reference counting policy for PoolRef with a plain counter,
+     for references that are only ever used by one thread.
+    */
+    struct PlainRefPolicy {
+        using Count = uint32_t;
+
+        static void increment(Count &count) { ++count; }
+
+        // Returns true if the count reached zero
+        static bool decrement(Count &count) { return --count == 0; }
+
+        static uint32_t load(const Count &count) { return count; }
+    };
+
+    /**
+     Reference counting policy for PoolRef with an atomic counter,
+     for references that are copied and dropped by several threads.
+     The last reference may be dropped on any thread, so the pool
+     must accept frees from any thread (such as RemoteFreeMemPool).
+    */
+    struct AtomicRefPolicy {
+        using Count = std::atomic<uint32_t>;
+
+        static void increment(Count &count) {
+            // A new reference can only be made from an existing one,
+            // so no ordering is needed
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static bool decrement(Count &count) {
+            // Every earlier use of the object must happen before it is destroyed
+            return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        static uint32_t load(const Count &count) { return count.load(std::memory_order_relaxed); }
+    };
+
+
+    /**
+     Pooled element of a RefPoolManager: an object together with its
+     reference count and the deleter that returns it to its pool.
+    */
+    template <typename T, class RefPolicy>
+    struct PoolRefSlot {
+        template <typename... Args>
+        PoolRefSlot(const DumbDeleter *deleter, Args&&... args)
+            : count(1),
+              deleter(deleter),
+              value(std::forward<Args>(args)...) {}
+
+        typename RefPolicy::Count count;
+        const DumbDeleter *deleter;
+        T value;
+    };
+
+
+    /**
+     Reference counted pointer to an object made by a RefPoolManager.
+     The count lives in the object's pooled slot, so a PoolRef is a single pointer
+     and making one does not allocate anything besides the slot.
+     When the last reference goes away, the object is destroyed
+     and its slot is returned to the pool.
+    */
+    template <typename T, class RefPolicy = PlainRefPolicy>
+    class PoolRef {
+    public:
+        using Slot = PoolRefSlot<T, RefPolicy>;
+
+        PoolRef() : m_slot(nullptr) {}
+        PoolRef(std::nullptr_t) : m_slot(nullptr) {}
+
+        /**
+         Takes over a reference that has already been counted in the slot.
+        */
+        explicit PoolRef(Slot *slot) : m_slot(slot) {}
+
+        PoolRef(const PoolRef &other) : m_slot(other.m_slot) {
+            if (m_slot)
+                RefPolicy::increment(m_slot->count);
+        }
+
+        PoolRef(PoolRef &&other) : m_slot(other.m_slot) {
+            other.m_slot = nullptr;
+        }
+
+        ~PoolRef() {
+            release();
+        }
+
+        PoolRef &operator=(PoolRef other) {
+            std::swap(m_slot, other.m_slot);
+            return *this;
+        }
+
+
+        void reset() {
+            release();
+            m_slot = nullptr;
+        }
+
+        T *get() const { return m_slot ? &(m_slot->value) : nullptr; }
+
+        T &operator*() const { return m_slot->value; }
+
+        T *operator->() const { return &(m_slot->value); }
+
+        explicit operator bool() const { return m_slot != nullptr; }
+
+        /**
+         Returns the number of references to the object, or 0 if this is null.
+        */
+        uint32_t useCount() const { return m_slot ? RefPolicy::load(m_slot->count) : 0; }
+
+    private:
+        void release() {
+            if (m_slot && RefPolicy::decrement(m_slot->count))
+                m_slot->deleter->free(m_slot);
+        }
+
+
+        Slot *m_slot;
+    };
+
+    template <typename T, class RefPolicy>
+    bool operator==(const PoolRef<T, RefPolicy> &a, const PoolRef<T, RefPolicy> &b) {
+        return a.get() == b.get();
+    }
+
+    template <typename T, class RefPolicy>
+    bool operator!=(const PoolRef<T, RefPolicy> &a, const PoolRef<T, RefPolicy> &b) {
+        return a.get() != b.get();
+    }
+
+
+    /**
+     Memory pool container that generates PoolRefs.
+     Like PoolManager, it must outlive the references it makes.
+    */
+    template <typename ElemType,
+              class RefPolicy = PlainRefPolicy,
+              class Allocator = std::allocator<MemNode<PoolRefSlot<ElemType, RefPolicy> > >,
+              class PoolType = MemPool<PoolRefSlot<ElemType, RefPolicy>, Allocator> >
+    class RefPoolManager {
+    public:
+        using Slot = PoolRefSlot<ElemType, RefPolicy>;
+        using Ref = PoolRef<ElemType, RefPolicy>;
+
+        RefPoolManager(size_t chunkSize = 10,
+                       Allocator allocator = Allocator(),
+                       size_t maxChunkSize = 0)
+            : m_pool(chunkSize, allocator, maxChunkSize),
+              m_deleter(m_pool) {}
+
+        RefPoolManager(const RefPoolManager&) = delete;
+        RefPoolManager &operator=(const RefPoolManager&) = delete;
+
+
+        template <typename... Args>
+        Ref make(Args&&... args) {
+            Slot *slot = m_pool.make(&m_deleter, std::forward<Args>(args)...);
+            return slot ? Ref(slot) : Ref();
+        }
+
+    protected:
+        PoolType m_pool;
+        DumbPoolDeleter<PoolType, Slot> m_deleter;
+    };
+}
+
+#endif // DU_POOL_REF_H
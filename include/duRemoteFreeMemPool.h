@@ -0,0 +1,187 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_REMOTE_FREE_MEM_POOL_H
+#define DU_REMOTE_FREE_MEM_POOL_H
+
+#include <atomic>
+#include <thread>
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     A memory pool that is owned by one thread but whose objects may be freed by any thread.
+     Only the owner may make objects. When the owner frees an object,
+     it goes straight back to the MemPool. When another thread frees one,
+     it is pushed onto a lock-free list of remote frees, which the owner
+     takes over with a single atomic exchange on its next make and returns
+     to the MemPool in one batch. So frees never contend with each other
+     for more than one compare-and-swap, and makes never wait on other threads.
+
+     The owner is the thread that constructed the pool until setOwner() is called.
+     Objects freed by other threads are not counted as free until the owner
+     next calls make, makeN or collect.
+
+     Like MemPool, this class does not call the destructors of outstanding objects
+     when it goes out of scope.
+    */
+    template <typename ElemType, class Allocator = std::allocator<MemNode<ElemType> > >
+    class RemoteFreeMemPool {
+    public:
+        using PoolType = MemPool<ElemType, Allocator>;
+        using TNode = typename PoolType::TNode;
+
+        RemoteFreeMemPool(size_t chunkSize = 10,
+                          Allocator allocator = Allocator(),
+                          size_t maxChunkSize = 0)
+            : m_pool(chunkSize, allocator, maxChunkSize),
+              m_owner(std::this_thread::get_id()),
+              m_remoteHead(nullptr) {}
+
+        RemoteFreeMemPool(const RemoteFreeMemPool&) = delete;
+        RemoteFreeMemPool &operator=(const RemoteFreeMemPool&) = delete;
+
+
+        /**
+         Must only be called by the owner thread.
+        */
+        template <typename... Args>
+        ElemType *make(Args&&... args) {
+            collect();
+            return m_pool.make(std::forward<Args>(args)...);
+        }
+
+        /**
+         Must only be called by the owner thread.
+         See MemPool::makeN.
+        */
+        template <typename... Args>
+        size_t makeN(size_t count, ElemType **out, const Args&... args) {
+            collect();
+            return m_pool.makeN(count, out, args...);
+        }
+
+
+        /**
+         May be called by any thread.
+        */
+        void free(ElemType *ptr) {
+            if (!ptr)
+                return;
+
+            if (std::this_thread::get_id() == m_owner) {
+                m_pool.free(ptr);
+                return;
+            }
+
+            ptr->~ElemType();
+            TNode *node = new (ptr) TNode();
+            pushRemote(node, node);
+        }
+
+        /**
+         May be called by any thread.
+         Frees from another thread are linked together first
+         and pushed onto the remote free list in one step.
+        */
+        void freeN(ElemType *const *ptrs, size_t count) {
+            if (std::this_thread::get_id() == m_owner) {
+                m_pool.freeN(ptrs, count);
+                return;
+            }
+
+            TNode *first = nullptr;
+            TNode *last = nullptr;
+            for (size_t i = 0; i < count; ++i) {
+                if (ptrs[i]) {
+                    ptrs[i]->~ElemType();
+
+                    TNode *node = new (ptrs[i]) TNode();
+                    node->next = first;
+                    first = node;
+                    if (!last)
+                        last = node;
+                }
+            }
+
+            if (first)
+                pushRemote(first, last);
+        }
+
+
+        /**
+         Returns the nodes freed by other threads to the MemPool.
+         Must only be called by the owner thread.
+         Returns the number of nodes collected.
+        */
+        size_t collect() {
+            // Cheap check first, so the common case does not write to the shared cache line
+            if (!m_remoteHead.load(std::memory_order_relaxed))
+                return 0;
+
+            TNode *first = m_remoteHead.exchange(nullptr, std::memory_order_acquire);
+            if (!first)
+                return 0;
+
+            TNode *last = first;
+            size_t count = 1;
+            while (last->next) {
+                last = last->next;
+                ++count;
+            }
+
+            m_pool.deallocateNodes(first, last, count);
+            return count;
+        }
+
+
+        /**
+         Makes the calling thread the owner of this pool.
+         No other thread may be using the pool while ownership changes.
+        */
+        void setOwner() {
+            m_owner = std::this_thread::get_id();
+        }
+
+        std::thread::id owner() const { return m_owner; }
+
+        /**
+         Returns the underlying MemPool, which must only be used by the owner thread.
+        */
+        PoolType &pool() { return m_pool; }
+
+    private:
+        // Pushes a chain of nodes linked from first to last onto the remote free list
+        void pushRemote(TNode *first, TNode *last) {
+            TNode *head = m_remoteHead.load(std::memory_order_relaxed);
+            do {
+                last->next = head;
+            } while (!m_remoteHead.compare_exchange_weak(head, first,
+                                                         std::memory_order_release,
+                                                         std::memory_order_relaxed));
+        }
+
+
+        PoolType m_pool;
+        std::thread::id m_owner;
+
+        // Written by other threads, so kept off the cache lines the owner uses
+        alignas(CACHE_LINE_SIZE) std::atomic<TNode*> m_remoteHead;
+    };
+}
+
+#endif // DU_REMOTE_FREE_MEM_POOL_H
@@ -0,0 +1,54 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_SHARED_POOL_MANAGER_H
+#define DU_SHARED_POOL_MANAGER_H
+
+#include <memory>
+#include "duPoolAllocator.h"
+
+namespace Diamond {
+
+    /**
+     Memory pool container that generates std::shared_ptrs with std::allocate_shared
+     and a PoolAllocator, so that each object and its shared_ptr control block
+     share one pooled node and making an object does not touch the global allocator.
+     (PoolManager with a shared_ptr PtrType allocates every control block separately.)
+     Each control block keeps a copy of the allocator, which keeps the pool alive,
+     so the objects may outlive the manager.
+    */
+    template <typename ElemType>
+    class SharedPoolManager {
+    public:
+        SharedPoolManager(size_t chunkSize = PoolAllocatorState::DEFAULT_CHUNK_SIZE,
+                          size_t maxChunkSize = PoolAllocatorState::DEFAULT_MAX_CHUNK_SIZE)
+            : m_allocator(chunkSize, maxChunkSize) {}
+
+
+        template <typename... Args>
+        std::shared_ptr<ElemType> make(Args&&... args) {
+            return std::allocate_shared<ElemType>(m_allocator, std::forward<Args>(args)...);
+        }
+
+
+        const PoolAllocator<ElemType> &allocator() const { return m_allocator; }
+
+    protected:
+        PoolAllocator<ElemType> m_allocator;
+    };
+}
+
+#endif // DU_SHARED_POOL_MANAGER_H
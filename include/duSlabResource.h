@@ -0,0 +1,185 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_SLAB_RESOURCE_H
+#define DU_SLAB_RESOURCE_H
+
+#if __cplusplus < 201703L
+#error "duSlabResource.h requires C++17 (std::pmr)"
+#endif
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include "duBits.h"
+#include "duMemPool.h"
+
+namespace Diamond {
+    /**
+     Untyped block of Size bytes, aligned to Size
+     or to alignof(std::max_align_t), whichever is smaller.
+    */
+    template <size_t Size>
+    struct SlabBlock {
+        alignas(Size < alignof(std::max_align_t) ? Size : alignof(std::max_align_t))
+        unsigned char bytes[Size];
+    };
+
+    /**
+     MemPool of SlabBlocks whose chunks come from a std::pmr::memory_resource.
+    */
+    template <size_t Size>
+    using SlabPool = MemPool<SlabBlock<Size>,
+                             std::pmr::polymorphic_allocator<MemNode<SlabBlock<Size> > > >;
+
+    /**
+     One SlabPool per given size, each reachable through a cast to SlabClass<Size>.
+    */
+    template <size_t Size>
+    struct SlabClass {
+        SlabClass(size_t chunkSize, std::pmr::memory_resource *upstream, size_t maxChunkSize)
+            : pool(chunkSize, upstream, maxChunkSize) {}
+
+        SlabPool<Size> pool;
+    };
+
+    template <size_t... Sizes>
+    struct SlabClasses : SlabClass<Sizes>... {
+        SlabClasses(size_t chunkSize, std::pmr::memory_resource *upstream, size_t maxChunkSize)
+            : SlabClass<Sizes>(chunkSize, upstream, maxChunkSize)... {}
+    };
+
+
+    /**
+     A std::pmr::memory_resource that serves any allocation of up to MAX_SIZE bytes
+     from one MemPool per power of two size class (8, 16, 32 ... 4096 bytes).
+     This way pmr containers and objects of different types can share pooled memory
+     without a pool for every type.
+     Allocations that are larger than MAX_SIZE or more aligned than std::max_align_t
+     are passed on to the upstream resource, which also provides the pools' chunks.
+     Like any MemPool, each size class takes its first chunk on construction;
+     trim() hands the unused ones back.
+
+     Like MemPool, this class is not thread safe.
+     Deallocating with a different size or alignment than was allocated with is undefined.
+    */
+    class SlabResource : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t MIN_SIZE = 8;
+        static constexpr size_t MAX_SIZE = 4096;
+        static constexpr size_t NUM_CLASSES = 10; // log2(MAX_SIZE / MIN_SIZE) + 1
+
+        explicit SlabResource(size_t chunkSize = 64,
+                              std::pmr::memory_resource *upstream = std::pmr::get_default_resource(),
+                              size_t maxChunkSize = 0)
+            : m_classes(chunkSize, upstream, maxChunkSize),
+              m_upstream(upstream) {}
+
+        SlabResource(const SlabResource&) = delete;
+        SlabResource &operator=(const SlabResource&) = delete;
+
+
+        std::pmr::memory_resource *upstream_resource() const { return m_upstream; }
+
+        /**
+         Returns the index of the size class that serves the given request,
+         or NUM_CLASSES if it goes to the upstream resource.
+        */
+        static size_t sizeClass(size_t bytes, size_t alignment) {
+            if (alignment > alignof(std::max_align_t))
+                return NUM_CLASSES;
+
+            size_t size = bytes > alignment ? bytes : alignment;
+            if (size > MAX_SIZE)
+                return NUM_CLASSES;
+            if (size < MIN_SIZE)
+                size = MIN_SIZE;
+
+            return Bits::ceilLog2(size) - Bits::ceilLog2(MIN_SIZE);
+        }
+
+        /**
+         Gives chunks without live blocks back to the upstream resource.
+         Returns the number of chunks released.
+        */
+        size_t trim() {
+            return trimPools(std::make_index_sequence<NUM_CLASSES>());
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            size_t index = sizeClass(bytes, alignment);
+            if (index == NUM_CLASSES)
+                return m_upstream->allocate(bytes, alignment);
+
+            void *p = allocateFrom(index, std::make_index_sequence<NUM_CLASSES>());
+            if (!p)
+                throw std::bad_alloc();
+            return p;
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            size_t index = sizeClass(bytes, alignment);
+            if (index == NUM_CLASSES)
+                m_upstream->deallocate(p, bytes, alignment);
+            else
+                deallocateTo(index, p, std::make_index_sequence<NUM_CLASSES>());
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        template <size_t Index>
+        SlabPool<(MIN_SIZE << Index)> &pool() {
+            return static_cast<SlabClass<(MIN_SIZE << Index)>&>(m_classes).pool;
+        }
+
+
+        // Each of these expands to a chain of comparisons against every class index,
+        // which the compiler turns into a jump table like a switch statement.
+
+        template <size_t... Is>
+        void *allocateFrom(size_t index, std::index_sequence<Is...>) {
+            void *p = nullptr;
+            ((index == Is && (p = pool<Is>().allocateNode())) || ...);
+            return p;
+        }
+
+        template <size_t... Is>
+        void deallocateTo(size_t index, void *p, std::index_sequence<Is...>) {
+            ((index == Is && (deallocateNode(pool<Is>(), p), true)) || ...);
+        }
+
+        template <size_t... Is>
+        size_t trimPools(std::index_sequence<Is...>) {
+            return (pool<Is>().trim() + ...);
+        }
+
+        template <class PoolType>
+        static void deallocateNode(PoolType &pool, void *p) {
+            pool.deallocateNode(new (p) typename PoolType::TNode());
+        }
+
+
+        SlabClasses<8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096> m_classes;
+        std::pmr::memory_resource *m_upstream;
+    };
+}
+
+#endif // DU_SLAB_RESOURCE_H
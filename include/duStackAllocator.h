@@ -0,0 +1,153 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_STACK_ALLOCATOR_H
+#define DU_STACK_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace Diamond {
+
+    /**
+     LIFO scratch allocator over one buffer of fixed capacity.
+     Allocating bumps the top of the stack. To free, take a marker with getMarker()
+     before a phase of work and roll back to it with freeToMarker() afterwards,
+     which frees everything allocated since in one step.
+     No bookkeeping is stored per allocation.
+
+     Rolling back does not call destructors, so objects made on the stack
+     should be trivially destructible or be destroyed by the caller.
+     allocate() and make() return nullptr when the stack is full.
+     Not thread safe.
+    */
+    class StackAllocator {
+    public:
+        using Marker = size_t;
+
+        /**
+         Rolls the stack back to where it was when the scope was constructed.
+        */
+        class Scope {
+        public:
+            explicit Scope(StackAllocator &stack)
+                : m_stack(stack),
+                  m_marker(stack.getMarker()) {}
+
+            Scope(const Scope&) = delete;
+            Scope &operator=(const Scope&) = delete;
+
+            ~Scope() {
+                m_stack.freeToMarker(m_marker);
+            }
+
+        private:
+            StackAllocator &m_stack;
+            Marker m_marker;
+        };
+
+
+        explicit StackAllocator(size_t capacity)
+            : m_buffer(static_cast<char*>(::operator new(capacity))),
+              m_capacity(capacity),
+              m_top(0) {}
+
+        StackAllocator(const StackAllocator&) = delete;
+        StackAllocator &operator=(const StackAllocator&) = delete;
+
+        ~StackAllocator() {
+            ::operator delete(m_buffer);
+        }
+
+
+        /**
+         Returns bytes of uninitialized memory aligned to align (a power of two),
+         or nullptr if they do not fit.
+        */
+        void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+            uintptr_t base = (uintptr_t)m_buffer;
+            uintptr_t start = (base + m_top + align - 1) & ~(uintptr_t)(align - 1);
+            if (start - base > m_capacity || bytes > m_capacity - (start - base))
+                return nullptr;
+
+            m_top = start - base + bytes;
+            return (void*)start;
+        }
+
+        template <typename T, typename... Args>
+        T *make(Args&&... args) {
+            void *p = allocate(sizeof(T), alignof(T));
+            if (!p)
+                return nullptr;
+            return new (p) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         Constructs count contiguous elements from the same arguments,
+         or returns nullptr if they do not fit.
+        */
+        template <typename T, typename... Args>
+        T *makeArray(size_t count, const Args&... args) {
+            if (count > (size_t)-1 / sizeof(T))
+                return nullptr;
+
+            T *arr = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+            if (!arr)
+                return nullptr;
+
+            for (size_t i = 0; i < count; ++i)
+                new (arr + i) T(args...);
+            return arr;
+        }
+
+
+        /**
+         Returns the current top of the stack.
+        */
+        Marker getMarker() const { return m_top; }
+
+        /**
+         Frees everything allocated since the marker was taken.
+        */
+        void freeToMarker(Marker marker) {
+            m_top = marker;
+        }
+
+        /**
+         Frees everything.
+        */
+        void clear() {
+            m_top = 0;
+        }
+
+
+        size_t capacity() const { return m_capacity; }
+
+        /**
+         Returns the number of bytes in use, including alignment padding.
+        */
+        size_t used() const { return m_top; }
+
+    private:
+        char *m_buffer;
+        size_t m_capacity;
+        size_t m_top; // Offset of the first free byte
+    };
+}
+
+#endif // DU_STACK_ALLOCATOR_H
@@ -0,0 +1,126 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_STATIC_MEM_POOL_H
+#define DU_STATIC_MEM_POOL_H
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     A memory pool for at most N elements, stored inside the pool object itself,
+     so it can live in static storage or on the stack and never touches the heap.
+     Like MemPool, freed nodes are recycled through an intrusive free list,
+     and nodes that have never been used are bumped off the end of the storage,
+     so constructing the pool does not initialize its storage.
+     make() returns nullptr once all N nodes are live.
+
+     The constructor is constexpr, so a pool with static storage duration is
+     constant initialized and can be used by the dynamic initializers of
+     other translation units, whatever order they run in.
+
+     Like MemPool, this class does not call the destructors of outstanding objects
+     when it goes out of scope.
+    */
+    template <typename ElemType, size_t N, size_t Align = alignof(ElemType)>
+    class StaticMemPool {
+    public:
+        using TNode = MemNode<ElemType, Align>;
+
+        static_assert(N > 0, "StaticMemPool must hold at least one element");
+
+        constexpr StaticMemPool()
+            : m_unused(0),
+              m_freeHead(nullptr),
+              m_used(0) {}
+
+        StaticMemPool(const StaticMemPool&) = delete;
+        StaticMemPool &operator=(const StaticMemPool&) = delete;
+
+
+        template <typename... Args>
+        ElemType *make(Args&&... args) {
+            TNode *ret;
+            if (m_freeHead) {
+                ret = m_freeHead;
+                m_freeHead = m_freeHead->next;
+            }
+            else if (m_used < N) {
+                ret = nodes() + m_used++;
+            }
+            else {
+                return nullptr;
+            }
+
+            new (&(ret->elem)) ElemType(std::forward<Args>(args)...);
+
+            return &(ret->elem);
+        }
+
+
+        void free(ElemType *ptr) {
+            if (ptr) {
+                ptr->~ElemType();
+
+                TNode *freed = new (ptr) TNode();
+                freed->next = m_freeHead;
+                m_freeHead = freed;
+            }
+        }
+
+
+        /**
+         Returns true if ptr points into this pool's storage.
+        */
+        bool owns(const ElemType *ptr) const {
+            return (uintptr_t)ptr >= (uintptr_t)nodes()
+                && (uintptr_t)ptr < (uintptr_t)(nodes() + N);
+        }
+
+        /**
+         Makes every node free without calling any destructors.
+         All pointers to elements of this pool become invalid.
+        */
+        void clear() {
+            m_freeHead = nullptr;
+            m_used = 0;
+        }
+
+        static constexpr size_t capacity() { return N; }
+
+    private:
+        TNode *nodes() { return reinterpret_cast<TNode*>(m_storage); }
+        const TNode *nodes() const { return reinterpret_cast<const TNode*>(m_storage); }
+
+
+        union {
+            // Initialized in place of the storage so that the constructor can be constexpr
+            unsigned char m_unused;
+            // Uninitialized, so that constructing the pool costs nothing
+            typename std::aligned_storage<sizeof(TNode), alignof(TNode)>::type m_storage[N];
+        };
+
+        TNode *m_freeHead; // Pointer to first element of free list of recycled nodes
+        size_t m_used; // Number of nodes at the start of the storage that have ever been handed out
+    };
+}
+
+#endif // DU_STATIC_MEM_POOL_H
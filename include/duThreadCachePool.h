@@ -0,0 +1,170 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_THREAD_CACHE_POOL_H
+#define DU_THREAD_CACHE_POOL_H
+
+#include <mutex>
+#include "duMemPool.h"
+
+namespace Diamond {
+
+    /**
+     A memory pool that can be shared between threads.
+     A central MemPool is guarded by a mutex, and each thread
+     makes and frees objects through its own ThreadCachePool::Cache.
+     A cache keeps a magazine of free nodes that it refills from and spills
+     to the central pool in batches, so most calls to Cache::make and Cache::free
+     do not lock or touch memory shared with other threads.
+
+     A Cache must only be used by one thread at a time,
+     and must be destroyed before the ThreadCachePool it was created with.
+     An object made by one cache may be freed by any other cache of the same pool.
+
+     Like MemPool, this class does not call the destructors of outstanding objects
+     when it goes out of scope.
+    */
+    template <typename ElemType, class Allocator = std::allocator<MemNode<ElemType> > >
+    class ThreadCachePool {
+    public:
+        using PoolType = MemPool<ElemType, Allocator>;
+        using TNode = typename PoolType::TNode;
+
+        /**
+         Per-thread front end of a ThreadCachePool.
+        */
+        class Cache {
+        public:
+            explicit Cache(ThreadCachePool &pool)
+                : m_pool(pool),
+                  m_head(nullptr),
+                  m_count(0) {}
+
+            Cache(const Cache&) = delete;
+            Cache &operator=(const Cache&) = delete;
+
+            ~Cache() {
+                flush();
+            }
+
+
+            template <typename... Args>
+            ElemType *make(Args&&... args) {
+                if (!m_head) {
+                    m_count = m_pool.takeBatch(m_head);
+                    if (!m_head)
+                        return nullptr;
+                }
+
+                TNode *ret = m_head;
+                m_head = m_head->next;
+                --m_count;
+
+                new (&(ret->elem)) ElemType(std::forward<Args>(args)...);
+
+                return &(ret->elem);
+            }
+
+
+            void free(ElemType *ptr) {
+                if (ptr) {
+                    ptr->~ElemType();
+
+                    TNode *freed = new (ptr) TNode();
+                    freed->next = m_head;
+                    m_head = freed;
+
+                    // Keep up to two batches so that alternating makes and frees
+                    // at the boundary do not bounce batches back and forth
+                    if (++m_count >= 2 * m_pool.m_batchSize)
+                        spill(m_pool.m_batchSize);
+                }
+            }
+
+
+            /**
+             Returns every node in this cache's magazine to the central pool.
+            */
+            void flush() {
+                spill(m_count);
+            }
+
+        private:
+            void spill(size_t count) {
+                if (count == 0)
+                    return;
+
+                TNode *first = m_head;
+                TNode *last = m_head;
+                for (size_t i = 1; i < count; ++i)
+                    last = last->next;
+
+                m_head = last->next;
+                m_count -= count;
+
+                m_pool.giveBatch(first, last, count);
+            }
+
+
+            ThreadCachePool &m_pool;
+
+            TNode *m_head; // Head of this cache's magazine of free nodes
+            size_t m_count; // Number of nodes in the magazine
+        };
+
+
+        ThreadCachePool(size_t batchSize = 32,
+                        size_t chunkSize = 256,
+                        Allocator allocator = Allocator(),
+                        size_t maxChunkSize = 0)
+            : m_pool(chunkSize, allocator, maxChunkSize),
+              m_batchSize(batchSize > 0 ? batchSize : 1) {}
+
+    private:
+        // Takes up to one batch of nodes from the central pool,
+        // linked through MemNode::next and terminated with nullptr.
+        // Returns the number of nodes taken.
+        size_t takeBatch(TNode *&head) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            head = nullptr;
+            size_t count = 0;
+            while (count < m_batchSize) {
+                TNode *node = m_pool.allocateNode();
+                if (!node)
+                    break;
+
+                node->next = head;
+                head = node;
+                ++count;
+            }
+            return count;
+        }
+
+        void giveBatch(TNode *first, TNode *last, size_t count) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pool.deallocateNodes(first, last, count);
+        }
+
+
+        std::mutex m_mutex;
+        PoolType m_pool;
+
+        size_t m_batchSize;
+    };
+}
+
+#endif // DU_THREAD_CACHE_POOL_H
@@ -0,0 +1,326 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_TLSF_H
+#define DU_TLSF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "duBits.h"
+
+namespace Diamond {
+
+    /**
+     Two-Level Segregated Fit allocator for variable-size blocks
+     over one region of memory, with O(1) allocate and deallocate.
+
+     Free blocks are kept in segregated lists: the first level splits sizes
+     by powers of two and the second level splits each power of two into
+     SL_COUNT equal ranges. Bitmaps of the non-empty lists let a list
+     that is guaranteed to fit the request be found with two bit scans,
+     and freed blocks are merged with free neighbours immediately,
+     so the time of every call is bounded independently of the heap's state.
+
+     The region is either allocated (and owned) by the Tlsf or supplied by the caller,
+     who must keep it alive for as long as the Tlsf is used.
+     Every block is aligned to ALIGN bytes and carries ALIGN bytes of header.
+     allocate() returns nullptr if no free block is large enough.
+     Not thread safe.
+    */
+    class Tlsf {
+    public:
+        static const size_t ALIGN = 16;
+        // 128 GB where size_t is 64 bits, 1 GB where it is 32 bits
+        static const size_t MAX_ALLOCATION = (size_t)1 << (sizeof(size_t) >= 8 ? 37 : 30);
+
+        /**
+         Manages a region of the given size, allocated with operator new.
+         Throws std::bad_alloc if the region is too small to hold a block.
+        */
+        explicit Tlsf(size_t bytes)
+            : m_owned(static_cast<char*>(::operator new(bytes))) {
+            try {
+                init(m_owned, bytes);
+            }
+            catch (...) {
+                // The destructor does not run for a constructor that throws
+                ::operator delete(m_owned);
+                throw;
+            }
+        }
+
+        /**
+         Manages the given region of memory, which it does not own.
+        */
+        Tlsf(void *memory, size_t bytes)
+            : m_owned(nullptr) {
+            init(static_cast<char*>(memory), bytes);
+        }
+
+        Tlsf(const Tlsf&) = delete;
+        Tlsf &operator=(const Tlsf&) = delete;
+
+        ~Tlsf() {
+            ::operator delete(m_owned);
+        }
+
+
+        void *allocate(size_t bytes) {
+            if (bytes > MAX_ALLOCATION)
+                return nullptr;
+
+            size_t size = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+            if (size < MIN_SIZE)
+                size = MIN_SIZE;
+
+            unsigned fl, sl;
+            Block *block = findFree(size, fl, sl);
+            if (!block)
+                return nullptr;
+
+            removeFree(block, fl, sl);
+
+            size_t blockSize = sizeOf(block);
+            if (blockSize >= size + OVERHEAD + MIN_SIZE) {
+                // Split off the rest of the block as a new free block
+                Block *rest = reinterpret_cast<Block*>(payload(block) + size);
+                rest->size = (blockSize - size - OVERHEAD) | FREE;
+                block->size = size | (block->size & (FREE | PREV_FREE));
+
+                Block *after = next(rest);
+                after->prevPhys = rest;
+                after->size |= PREV_FREE;
+
+                insertFree(rest);
+            }
+            else {
+                next(block)->size &= ~PREV_FREE;
+            }
+
+            block->size &= ~FREE;
+            m_used += sizeOf(block);
+
+            return payload(block);
+        }
+
+
+        void deallocate(void *ptr) {
+            if (!ptr)
+                return;
+
+            Block *block = reinterpret_cast<Block*>(static_cast<char*>(ptr) - OVERHEAD);
+            m_used -= sizeOf(block);
+            block->size |= FREE;
+
+            // Merge with the neighbours on either side if they are free.
+            // Two free blocks are never adjacent, so one merge per side is enough.
+            if (block->size & PREV_FREE) {
+                Block *prev = block->prevPhys;
+                removeFree(prev);
+                prev->size += OVERHEAD + sizeOf(block);
+                block = prev;
+            }
+
+            Block *after = next(block);
+            if (after->size & FREE) {
+                removeFree(after);
+                block->size += OVERHEAD + sizeOf(after);
+                after = next(block);
+            }
+
+            after->prevPhys = block;
+            after->size |= PREV_FREE;
+
+            insertFree(block);
+        }
+
+
+        /**
+         Returns the number of bytes in allocated blocks, not counting headers.
+        */
+        size_t used() const { return m_used; }
+
+    private:
+        // Header of a block. The payload starts OVERHEAD bytes after it.
+        struct Block {
+            Block *prevPhys; // Block before this one in memory, only valid if PREV_FREE is set
+            size_t size; // Size of the payload, with FREE and PREV_FREE in the low bits
+        };
+
+        // Stored in the payload of a free block
+        struct FreeLinks {
+            Block *next;
+            Block *prev;
+        };
+
+        static const size_t OVERHEAD = ALIGN;
+        static const size_t MIN_SIZE = sizeof(FreeLinks) > ALIGN ? sizeof(FreeLinks) : ALIGN;
+
+        static const size_t FREE = 1;
+        static const size_t PREV_FREE = 2;
+
+        static const unsigned ALIGN_LOG2 = 4;
+        static const unsigned SL_LOG2 = 5;
+        static const unsigned SL_COUNT = 1 << SL_LOG2;
+        static const unsigned FL_SHIFT = SL_LOG2 + ALIGN_LOG2; // Sizes below 2^FL_SHIFT are all in list 0
+        static const unsigned FL_MAX = sizeof(size_t) >= 8 ? 38 : 31; // Blocks must be smaller than 2^FL_MAX
+        static const unsigned FL_COUNT = FL_MAX - FL_SHIFT + 1;
+        static const size_t SMALL_SIZE = (size_t)1 << FL_SHIFT;
+
+        static_assert(sizeof(Block) <= OVERHEAD, "Block header must fit in OVERHEAD");
+        static_assert((size_t)1 << ALIGN_LOG2 == ALIGN, "ALIGN_LOG2 must match ALIGN");
+        static_assert(FL_MAX < sizeof(size_t) * 8, "Block sizes must fit in size_t");
+        static_assert(MAX_ALLOCATION <= (size_t)1 << (FL_MAX - 1), "Rounded requests must map to a list");
+
+
+        static size_t sizeOf(const Block *block) {
+            return block->size & ~(FREE | PREV_FREE);
+        }
+
+        static char *payload(Block *block) {
+            return reinterpret_cast<char*>(block) + OVERHEAD;
+        }
+
+        static Block *next(Block *block) {
+            return reinterpret_cast<Block*>(payload(block) + sizeOf(block));
+        }
+
+        static FreeLinks *links(Block *block) {
+            return reinterpret_cast<FreeLinks*>(payload(block));
+        }
+
+        static unsigned floorLog2(size_t x) {
+            return 63 - Bits::countLeadingZeros(x);
+        }
+
+        // Returns the lists that a block of the given size belongs in
+        static void mapping(size_t size, unsigned &fl, unsigned &sl) {
+            if (size < SMALL_SIZE) {
+                fl = 0;
+                sl = (unsigned)(size >> ALIGN_LOG2);
+            }
+            else {
+                unsigned log = floorLog2(size);
+                sl = (unsigned)(size >> (log - SL_LOG2)) ^ SL_COUNT;
+                fl = log - FL_SHIFT + 1;
+            }
+        }
+
+
+        void init(char *memory, size_t bytes) {
+            m_used = 0;
+            m_flBitmap = 0;
+            for (unsigned fl = 0; fl < FL_COUNT; ++fl) {
+                m_slBitmaps[fl] = 0;
+                for (unsigned sl = 0; sl < SL_COUNT; ++sl)
+                    m_heads[fl][sl] = nullptr;
+            }
+
+            uintptr_t start = ((uintptr_t)memory + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1);
+            uintptr_t end = ((uintptr_t)memory + bytes) & ~(uintptr_t)(ALIGN - 1);
+            if (end < start + 2 * OVERHEAD + MIN_SIZE)
+                throw std::bad_alloc();
+
+            // One free block covering the region, followed by a used block of size 0
+            // that keeps merges from running off the end
+            size_t size = end - start - 2 * OVERHEAD;
+            const size_t maxBlock = ((size_t)1 << FL_MAX) - ALIGN;
+            if (size > maxBlock)
+                size = maxBlock;
+
+            Block *first = reinterpret_cast<Block*>(start);
+            first->prevPhys = nullptr;
+            first->size = size | FREE;
+
+            Block *sentinel = next(first);
+            sentinel->prevPhys = first;
+            sentinel->size = PREV_FREE;
+
+            insertFree(first);
+        }
+
+        // Returns a free block of at least size bytes, and the lists it is in
+        Block *findFree(size_t size, unsigned &fl, unsigned &sl) {
+            // Round up to the next list boundary,
+            // so that every block in the list found is large enough
+            if (size >= SMALL_SIZE)
+                size += ((size_t)1 << (floorLog2(size) - SL_LOG2)) - 1;
+            mapping(size, fl, sl);
+
+            uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+            if (!slMap) {
+                uint32_t flMap = m_flBitmap & (~0u << (fl + 1));
+                if (!flMap)
+                    return nullptr;
+
+                fl = Bits::countTrailingZeros(flMap);
+                slMap = m_slBitmaps[fl];
+            }
+            sl = Bits::countTrailingZeros(slMap);
+
+            return m_heads[fl][sl];
+        }
+
+        void insertFree(Block *block) {
+            unsigned fl, sl;
+            mapping(sizeOf(block), fl, sl);
+
+            Block *head = m_heads[fl][sl];
+            links(block)->next = head;
+            links(block)->prev = nullptr;
+            if (head)
+                links(head)->prev = block;
+            m_heads[fl][sl] = block;
+
+            m_flBitmap |= 1u << fl;
+            m_slBitmaps[fl] |= 1u << sl;
+        }
+
+        void removeFree(Block *block) {
+            unsigned fl, sl;
+            mapping(sizeOf(block), fl, sl);
+            removeFree(block, fl, sl);
+        }
+
+        void removeFree(Block *block, unsigned fl, unsigned sl) {
+            Block *prev = links(block)->prev;
+            Block *after = links(block)->next;
+            if (prev)
+                links(prev)->next = after;
+            else
+                m_heads[fl][sl] = after;
+            if (after)
+                links(after)->prev = prev;
+
+            if (!m_heads[fl][sl]) {
+                m_slBitmaps[fl] &= ~(1u << sl);
+                if (!m_slBitmaps[fl])
+                    m_flBitmap &= ~(1u << fl);
+            }
+        }
+
+
+        char *m_owned; // Region allocated by this Tlsf, or nullptr
+        size_t m_used;
+
+        uint32_t m_flBitmap; // Bit fl is set if any list of first level fl is non-empty
+        uint32_t m_slBitmaps[FL_COUNT]; // Bit sl of entry fl is set if list [fl][sl] is non-empty
+        Block *m_heads[FL_COUNT][SL_COUNT]; // Heads of the free lists
+    };
+}
+
+#endif // DU_TLSF_H
@@ -0,0 +1,101 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "duHugePageAllocator.h"
+#include "duMemPool.h"
+
+using namespace Diamond;
+
+namespace {
+    const size_t NUM_NODES = 1 << 22;
+    const size_t NUM_STEPS = 1 << 24;
+    const size_t CHUNK_SIZE = 1024;
+
+    struct Entity {
+        Entity *next;
+        size_t payload[3];
+    };
+
+    // Links every entity of the pool into one cycle in random order,
+    // then follows the cycle. Returns nanoseconds per step.
+    template <class PoolType>
+    double chase(PoolType &pool) {
+        std::vector<Entity*> entities;
+        entities.reserve(NUM_NODES);
+        for (size_t i = 0; i < NUM_NODES; ++i)
+            entities.push_back(pool.make());
+
+        std::mt19937 rng(42);
+        std::shuffle(entities.begin(), entities.end(), rng);
+        for (size_t i = 0; i < NUM_NODES; ++i) {
+            entities[i]->next = entities[(i + 1) % NUM_NODES];
+            entities[i]->payload[0] = i;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        Entity *e = entities[0];
+        size_t sum = 0;
+        for (size_t i = 0; i < NUM_STEPS; ++i) {
+            sum += e->payload[0];
+            e = e->next;
+        }
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        // keep the loop from being optimized away
+        if (sum == 1)
+            std::printf(" ");
+
+        for (auto p : entities)
+            pool.free(p);
+
+        return elapsed.count() / NUM_STEPS;
+    }
+}
+
+int main() {
+    std::printf("Pointer chasing over %zu pooled entities of %zu bytes, %zu steps\n",
+                NUM_NODES, sizeof(Entity), NUM_STEPS);
+
+    {
+        MemPool<Entity> pool(CHUNK_SIZE);
+        std::printf("%-40s %8.2f ns/step\n", "std::allocator, fixed chunks", chase(pool));
+    }
+    {
+        MemPool<Entity> pool(CHUNK_SIZE, std::allocator<MemNode<Entity> >(), NUM_NODES);
+        std::printf("%-40s %8.2f ns/step\n", "std::allocator, doubling chunks", chase(pool));
+    }
+    {
+        using Allocator = HugePageAllocator<MemNode<Entity> >;
+        MemPool<Entity, Allocator> pool(CHUNK_SIZE);
+        std::printf("%-40s %8.2f ns/step\n", "HugePageAllocator (transparent)", chase(pool));
+    }
+    {
+        using Allocator = HugePageAllocator<MemNode<Entity> >;
+        auto arena = std::make_shared<HugePageArena>(NUM_NODES * sizeof(MemNode<Entity>) * 2, true);
+        MemPool<Entity, Allocator> pool(CHUNK_SIZE, Allocator(arena));
+        std::printf("%-40s %8.2f ns/step\n",
+                    arena->explicitHugePages() ? "HugePageAllocator (explicit)"
+                                               : "HugePageAllocator (explicit unavailable)",
+                    chase(pool));
+    }
+}
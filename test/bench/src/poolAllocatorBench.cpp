@@ -0,0 +1,119 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "duPoolAllocator.h"
+
+using namespace Diamond;
+
+namespace {
+    const int NUM_KEYS = 1 << 16;
+    const int NUM_OPS = 1 << 22;
+
+    // Random keys, generated once so that both allocators see the same sequence
+    std::vector<int> makeKeys() {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> dist(0, NUM_KEYS - 1);
+        std::vector<int> keys(NUM_OPS);
+        for (int &key : keys)
+            key = dist(rng);
+        return keys;
+    }
+
+    // Times a churn of inserts and erases on a map-like container,
+    // keeping about NUM_KEYS / 2 elements alive. Returns nanoseconds per operation.
+    template <class MapType>
+    double churnMap(MapType &map, const std::vector<int> &keys) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int key : keys) {
+            auto it = map.find(key);
+            if (it == map.end())
+                map.emplace(key, key);
+            else
+                map.erase(it);
+        }
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / keys.size();
+    }
+
+    // Times pushes to one end of a list and pops from the other,
+    // keeping up to NUM_KEYS elements alive. Returns nanoseconds per operation.
+    template <class ListType>
+    double churnList(ListType &list, const std::vector<int> &keys) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (int key : keys) {
+            if (key & 1 || list.empty())
+                list.push_back(key);
+            else
+                list.pop_front();
+        }
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / keys.size();
+    }
+
+
+    template <typename T>
+    using StdAlloc = std::allocator<T>;
+
+    template <typename T>
+    using PoolAlloc = PoolAllocator<T>;
+
+    template <template <typename> class Alloc>
+    using Map = std::map<int, int, std::less<int>, Alloc<std::pair<const int, int> > >;
+
+    template <template <typename> class Alloc>
+    using HashMap = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                       Alloc<std::pair<const int, int> > >;
+
+    template <template <typename> class Alloc>
+    using List = std::list<int, Alloc<int> >;
+}
+
+int main() {
+    std::vector<int> keys = makeKeys();
+
+    std::printf("%16s %16s %16s\n", "container", "std::allocator", "PoolAllocator");
+    std::printf("%16s %16s %16s\n", "", "(ns/op)", "(ns/op)");
+
+    {
+        Map<StdAlloc> stdMap;
+        Map<PoolAlloc> poolMap(PoolAllocator<int>(1024, 1 << 16));
+        std::printf("%16s %16.2f %16.2f\n", "std::map",
+                    churnMap(stdMap, keys), churnMap(poolMap, keys));
+    }
+    {
+        HashMap<StdAlloc> stdMap;
+        HashMap<PoolAlloc> poolMap(0, std::hash<int>(), std::equal_to<int>(), PoolAllocator<int>(1024, 1 << 16));
+        std::printf("%16s %16.2f %16.2f\n", "unordered_map",
+                    churnMap(stdMap, keys), churnMap(poolMap, keys));
+    }
+    {
+        List<StdAlloc> stdList;
+        List<PoolAlloc> poolList(PoolAllocator<int>(1024, 1 << 16));
+        std::printf("%16s %16.2f %16.2f\n", "std::list",
+                    churnList(stdList, keys), churnList(poolList, keys));
+    }
+}
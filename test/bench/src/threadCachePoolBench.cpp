@@ -0,0 +1,127 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "duThreadCachePool.h"
+#include "duVector2.h"
+
+using namespace Diamond;
+
+namespace {
+    const int OPS_PER_THREAD = 1 << 20;
+    const int WINDOW = 64; // objects each thread keeps alive at once
+
+    using Elem = Vector2<double>;
+
+    // Each thread repeatedly makes a window of objects and then frees them.
+    // Returns millions of make/free pairs per second over all threads.
+    template <typename MakeFn, typename FreeFn>
+    double run(int numThreads, MakeFn makeFn, FreeFn freeFn) {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&makeFn, &freeFn]() {
+                auto state = makeFn.begin();
+                Elem *window[WINDOW];
+                for (int i = 0; i < OPS_PER_THREAD; i += WINDOW) {
+                    for (int j = 0; j < WINDOW; ++j)
+                        window[j] = makeFn(state, j);
+                    for (int j = 0; j < WINDOW; ++j)
+                        freeFn(state, window[j]);
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return (double)OPS_PER_THREAD * numThreads / elapsed.count() / 1e6;
+    }
+
+
+    struct NoState {};
+
+    struct NewMake {
+        NoState begin() const { return NoState(); }
+        Elem *operator()(NoState&, int j) const { return new Elem(j, j); }
+    };
+    struct NewFree {
+        void operator()(NoState&, Elem *p) const { delete p; }
+    };
+
+
+    struct LockedPool {
+        std::mutex mutex;
+        MemPool<Elem> pool{256};
+    };
+
+    struct LockedMake {
+        LockedPool *locked;
+        NoState begin() const { return NoState(); }
+        Elem *operator()(NoState&, int j) const {
+            std::lock_guard<std::mutex> lock(locked->mutex);
+            return locked->pool.make(j, j);
+        }
+    };
+    struct LockedFree {
+        LockedPool *locked;
+        void operator()(NoState&, Elem *p) const {
+            std::lock_guard<std::mutex> lock(locked->mutex);
+            locked->pool.free(p);
+        }
+    };
+
+
+    using CachePool = ThreadCachePool<Elem>;
+
+    struct CacheMake {
+        CachePool *pool;
+        std::unique_ptr<CachePool::Cache> begin() const {
+            return std::unique_ptr<CachePool::Cache>(new CachePool::Cache(*pool));
+        }
+        Elem *operator()(std::unique_ptr<CachePool::Cache> &cache, int j) const {
+            return cache->make(j, j);
+        }
+    };
+    struct CacheFree {
+        void operator()(std::unique_ptr<CachePool::Cache> &cache, Elem *p) const {
+            cache->free(p);
+        }
+    };
+}
+
+int main() {
+    std::printf("%8s %16s %16s %16s\n", "threads", "new/delete", "mutex MemPool", "ThreadCachePool");
+    std::printf("%8s %16s %16s %16s\n", "", "(Mops/s)", "(Mops/s)", "(Mops/s)");
+
+    for (int numThreads = 1; numThreads <= 64; numThreads *= 2) {
+        double newRate = run(numThreads, NewMake(), NewFree());
+
+        LockedPool locked;
+        double lockedRate = run(numThreads, LockedMake{&locked}, LockedFree{&locked});
+
+        CachePool cachePool(WINDOW / 2, 256);
+        double cacheRate = run(numThreads, CacheMake{&cachePool}, CacheFree());
+
+        std::printf("%8d %16.2f %16.2f %16.2f\n", numThreads, newRate, lockedRate, cacheRate);
+    }
+}
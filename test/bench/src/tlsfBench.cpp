@@ -0,0 +1,113 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "duTlsf.h"
+
+using namespace Diamond;
+
+namespace {
+    const size_t NUM_LIVE = 1 << 12; // blocks kept alive at once
+    const size_t NUM_OPS = 1 << 20;
+    const size_t REGION_SIZE = (size_t)256 * 1024 * 1024;
+
+    // Mostly small buffers, with an occasional large one
+    struct Request {
+        size_t slot;
+        size_t size;
+    };
+
+    std::vector<Request> makeRequests() {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> slotDist(0, NUM_LIVE - 1);
+        std::uniform_int_distribution<size_t> smallDist(16, 4096);
+        std::uniform_int_distribution<size_t> largeDist(4096, 256 * 1024);
+
+        std::vector<Request> requests(NUM_OPS);
+        for (Request &r : requests)
+            r = Request{slotDist(rng), rng() % 64 == 0 ? largeDist(rng) : smallDist(rng)};
+        return requests;
+    }
+
+    // Replaces a random live block with a new one for every request,
+    // timing each allocation and each free on its own.
+    // Returns the latencies in nanoseconds.
+    template <typename AllocFn, typename FreeFn>
+    std::vector<double> run(const std::vector<Request> &requests, AllocFn allocFn, FreeFn freeFn) {
+        using Clock = std::chrono::steady_clock;
+
+        std::vector<void*> live(NUM_LIVE, nullptr);
+        for (size_t i = 0; i < NUM_LIVE; ++i)
+            live[i] = allocFn(requests[i].size);
+
+        std::vector<double> latencies;
+        latencies.reserve(2 * requests.size());
+
+        for (const Request &r : requests) {
+            auto t0 = Clock::now();
+            freeFn(live[r.slot]);
+            auto t1 = Clock::now();
+            live[r.slot] = allocFn(r.size);
+            auto t2 = Clock::now();
+
+            // Touch the block like a real user would
+            if (live[r.slot])
+                *static_cast<volatile char*>(live[r.slot]) = 1;
+
+            latencies.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            latencies.push_back(std::chrono::duration<double, std::nano>(t2 - t1).count());
+        }
+
+        for (void *p : live)
+            freeFn(p);
+
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    }
+
+    double percentile(const std::vector<double> &sorted, double p) {
+        return sorted[(size_t)(p * (sorted.size() - 1))];
+    }
+
+    void report(const char *name, const std::vector<double> &sorted) {
+        std::printf("%16s %10.0f %10.0f %10.0f %10.0f %12.0f\n", name,
+                    percentile(sorted, 0.5), percentile(sorted, 0.99),
+                    percentile(sorted, 0.999), percentile(sorted, 0.9999), sorted.back());
+    }
+}
+
+int main() {
+    std::vector<Request> requests = makeRequests();
+
+    std::printf("%16s %10s %10s %10s %10s %12s\n", "allocator", "p50", "p99", "p99.9", "p99.99", "max");
+    std::printf("%16s %10s %10s %10s %10s %12s\n", "", "(ns)", "(ns)", "(ns)", "(ns)", "(ns)");
+
+    report("malloc", run(requests,
+                         [](size_t size) { return std::malloc(size); },
+                         [](void *p) { std::free(p); }));
+
+    // The region is zeroed up front so that page faults are not counted against Tlsf
+    std::vector<char> region(REGION_SIZE);
+    Tlsf tlsf(region.data(), region.size());
+    report("Tlsf", run(requests,
+                       [&tlsf](size_t size) { return tlsf.allocate(size); },
+                       [&tlsf](void *p) { tlsf.deallocate(p); }));
+}
@@ -0,0 +1,261 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "duBench.h"
+#include "duSparseVector.h"
+#include "duSwapVector.h"
+#include "duVector2.h"
+
+using namespace Diamond;
+using DiamondBench::doNotOptimize;
+
+namespace {
+    const size_t NUM_ELEMS = 4096;
+
+    using Elem = Vector2<float>;
+    using ElemMap = std::unordered_map<tD_id, Elem>;
+
+    // Same random sequence of ids for every container
+    const std::vector<tD_id> &randomIds() {
+        static std::vector<tD_id> ids = [] {
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<tD_id> dist(0, NUM_ELEMS - 1);
+            std::vector<tD_id> v(NUM_ELEMS);
+            for (tD_id &id : v)
+                id = dist(rng);
+            return v;
+        }();
+        return ids;
+    }
+
+    template <class Container>
+    void fill(Container &c) {
+        for (size_t i = 0; i < NUM_ELEMS; ++i)
+            c.emplace((float)i, (float)i);
+    }
+
+    void fill(std::vector<Elem> &v) {
+        for (size_t i = 0; i < NUM_ELEMS; ++i)
+            v.emplace_back((float)i, (float)i);
+    }
+
+    void fill(ElemMap &m) {
+        for (size_t i = 0; i < NUM_ELEMS; ++i)
+            m.emplace((tD_id)i, Elem((float)i, (float)i));
+    }
+}
+
+
+// Emplace NUM_ELEMS elements into an empty container
+
+DU_BENCHMARK(StdVector, Emplace) {
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        std::vector<Elem> v;
+        fill(v);
+        doNotOptimize(v.data());
+    }
+}
+
+DU_BENCHMARK(StdUnorderedMap, Emplace) {
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        ElemMap m;
+        fill(m);
+        doNotOptimize(m);
+    }
+}
+
+DU_BENCHMARK(SwapVector, Emplace) {
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        SwapVector<Elem> v;
+        fill(v);
+        doNotOptimize(v.data().data());
+    }
+}
+
+DU_BENCHMARK(SparseVector, Emplace) {
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        SparseVector<Elem> v;
+        fill(v);
+        doNotOptimize(v[0]);
+    }
+}
+
+
+// Erase an element by id and emplace a new one, keeping NUM_ELEMS alive.
+// std::vector has no stable ids, so it erases by position.
+
+DU_BENCHMARK(StdVector, EraseEmplace) {
+    std::vector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    size_t next = 0;
+    while (state.keepRunning()) {
+        v.erase(v.begin() + ids[next]);
+        v.emplace_back(1.0f, 2.0f);
+        next = (next + 1) % ids.size();
+    }
+}
+
+DU_BENCHMARK(StdUnorderedMap, EraseEmplace) {
+    ElemMap m;
+    fill(m);
+    const std::vector<tD_id> &ids = randomIds();
+    size_t next = 0;
+    while (state.keepRunning()) {
+        m.erase(ids[next]);
+        m.emplace(ids[next], Elem(1.0f, 2.0f));
+        next = (next + 1) % ids.size();
+    }
+}
+
+DU_BENCHMARK(SwapVector, EraseEmplace) {
+    SwapVector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    size_t next = 0;
+    while (state.keepRunning()) {
+        // The freed id is reused by the emplace, so every id stays valid
+        v.erase(ids[next]);
+        v.emplace(1.0f, 2.0f);
+        next = (next + 1) % ids.size();
+    }
+}
+
+DU_BENCHMARK(SparseVector, EraseEmplace) {
+    SparseVector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    size_t next = 0;
+    while (state.keepRunning()) {
+        v.erase(ids[next]);
+        v.emplace(1.0f, 2.0f);
+        next = (next + 1) % ids.size();
+    }
+}
+
+
+// Sum every element
+
+DU_BENCHMARK(StdVector, Iterate) {
+    std::vector<Elem> v;
+    fill(v);
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        Elem sum;
+        for (const Elem &e : v)
+            sum += e;
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(StdUnorderedMap, Iterate) {
+    ElemMap m;
+    fill(m);
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        Elem sum;
+        for (const auto &entry : m)
+            sum += entry.second;
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(SwapVector, Iterate) {
+    SwapVector<Elem> v;
+    fill(v);
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        Elem sum;
+        for (const Elem &e : v)
+            sum += e;
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(SparseVector, Iterate) {
+    SparseVector<Elem> v;
+    fill(v);
+    state.setItemsPerIteration(NUM_ELEMS);
+    while (state.keepRunning()) {
+        // No element has been erased, so every id is valid
+        Elem sum;
+        for (tD_id id = 0; id < v.size(); ++id)
+            sum += v[id];
+        doNotOptimize(sum);
+    }
+}
+
+
+// Sum the elements at random ids
+
+DU_BENCHMARK(StdVector, RandomAccess) {
+    std::vector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    state.setItemsPerIteration(ids.size());
+    while (state.keepRunning()) {
+        Elem sum;
+        for (tD_id id : ids)
+            sum += v[id];
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(StdUnorderedMap, RandomAccess) {
+    ElemMap m;
+    fill(m);
+    const std::vector<tD_id> &ids = randomIds();
+    state.setItemsPerIteration(ids.size());
+    while (state.keepRunning()) {
+        Elem sum;
+        for (tD_id id : ids)
+            sum += m.find(id)->second;
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(SwapVector, RandomAccess) {
+    SwapVector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    state.setItemsPerIteration(ids.size());
+    while (state.keepRunning()) {
+        Elem sum;
+        for (tD_id id : ids)
+            sum += v[id];
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(SparseVector, RandomAccess) {
+    SparseVector<Elem> v;
+    fill(v);
+    const std::vector<tD_id> &ids = randomIds();
+    state.setItemsPerIteration(ids.size());
+    while (state.keepRunning()) {
+        Elem sum;
+        for (tD_id id : ids)
+            sum += v[id];
+        doNotOptimize(sum);
+    }
+}
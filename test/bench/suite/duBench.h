@@ -0,0 +1,242 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DU_BENCH_H
+#define DU_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ Minimal benchmark harness for BenchDiamondUtils.
+
+ A benchmark is defined like a gtest test:
+
+     DU_BENCHMARK(MemPool, MakeFree) {
+         MemPool<int> pool;          // setup, not timed
+         while (state.keepRunning()) {
+             ...                     // one iteration, timed
+         }
+     }
+
+ Each benchmark is first calibrated to the number of iterations that takes
+ about MIN_SAMPLE_TIME, then run SAMPLES times with that many iterations.
+ The median, fastest and slowest sample are reported in nanoseconds per iteration
+ (and per item, if the benchmark calls setItemsPerIteration).
+*/
+namespace DiamondBench {
+    const double MIN_SAMPLE_TIME = 0.05; // seconds
+    const int SAMPLES = 5;
+
+    class State {
+    public:
+        explicit State(size_t iterations)
+            : m_iterations(iterations),
+              m_remaining(iterations),
+              m_itemsPerIteration(1),
+              m_started(false) {}
+
+        /**
+         Returns true while there are iterations left to run.
+         The clock starts on the first call and stops on the last.
+        */
+        bool keepRunning() {
+            if (!m_started) {
+                m_started = true;
+                m_start = Clock::now();
+            }
+            if (m_remaining == 0) {
+                m_end = Clock::now();
+                return false;
+            }
+            --m_remaining;
+            return true;
+        }
+
+        void setItemsPerIteration(size_t items) { m_itemsPerIteration = items; }
+
+        size_t iterations() const { return m_iterations; }
+        size_t itemsPerIteration() const { return m_itemsPerIteration; }
+
+        double seconds() const {
+            return std::chrono::duration<double>(m_end - m_start).count();
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        size_t m_iterations;
+        size_t m_remaining;
+        size_t m_itemsPerIteration;
+        bool m_started;
+        Clock::time_point m_start;
+        Clock::time_point m_end;
+    };
+
+
+    using BenchFn = void (*)(State&);
+
+    struct Benchmark {
+        std::string name;
+        BenchFn fn;
+    };
+
+    inline std::vector<Benchmark> &registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar {
+        Registrar(const char *group, const char *name, BenchFn fn) {
+            registry().push_back(Benchmark{std::string(group) + "/" + name, fn});
+        }
+    };
+
+
+    /**
+     Keeps the compiler from optimizing away the computation of value.
+    */
+    template <typename T>
+    inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+
+    struct Result {
+        std::string name;
+        size_t iterations;
+        size_t itemsPerIteration;
+        double medianNs; // Per iteration
+        double minNs;
+        double maxNs;
+    };
+
+    inline Result run(const Benchmark &bench) {
+        // Grow the iteration count until one sample takes long enough
+        size_t iterations = 1;
+        while (true) {
+            State state(iterations);
+            bench.fn(state);
+            if (state.seconds() >= MIN_SAMPLE_TIME || iterations >= ((size_t)1 << 40))
+                break;
+
+            double scale = state.seconds() > 0 ? MIN_SAMPLE_TIME / state.seconds() * 1.2 : 10;
+            iterations = (size_t)(iterations * std::min(std::max(scale, 2.0), 10.0));
+        }
+
+        std::vector<double> samples;
+        size_t items = 1;
+        for (int i = 0; i < SAMPLES; ++i) {
+            State state(iterations);
+            bench.fn(state);
+            samples.push_back(state.seconds() * 1e9 / iterations);
+            items = state.itemsPerIteration();
+        }
+        std::sort(samples.begin(), samples.end());
+
+        return Result{bench.name, iterations, items, samples[SAMPLES / 2], samples.front(), samples.back()};
+    }
+
+
+    inline void writeJson(std::FILE *out, const std::vector<Result> &results) {
+        std::fprintf(out, "{\n  \"context\": {\n");
+#ifdef __VERSION__
+        std::fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+        std::fprintf(out, "    \"samples\": %d,\n", SAMPLES);
+        std::fprintf(out, "    \"min_sample_time_s\": %g\n  },\n", MIN_SAMPLE_TIME);
+        std::fprintf(out, "  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            std::fprintf(out,
+                         "    {\"name\": \"%s\", \"iterations\": %zu, \"items_per_iteration\": %zu, "
+                         "\"ns_per_iteration\": %.3f, \"ns_per_item\": %.3f, "
+                         "\"min_ns_per_iteration\": %.3f, \"max_ns_per_iteration\": %.3f}%s\n",
+                         r.name.c_str(), r.iterations, r.itemsPerIteration,
+                         r.medianNs, r.medianNs / r.itemsPerIteration,
+                         r.minNs, r.maxNs,
+                         i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+
+    /**
+     Runs every registered benchmark whose name contains the filter.
+     Command line: [--filter <substring>] [--json <file>, or - for stdout]
+    */
+    inline int main(int argc, char **argv) {
+        const char *filter = "";
+        const char *jsonPath = nullptr;
+        for (int i = 1; i < argc; ++i) {
+            if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+                filter = argv[++i];
+            else if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+                jsonPath = argv[++i];
+            else {
+                std::fprintf(stderr, "usage: %s [--filter <substring>] [--json <file>|-]\n", argv[0]);
+                return 1;
+            }
+        }
+
+        bool jsonToStdout = jsonPath && !std::strcmp(jsonPath, "-");
+        std::FILE *table = jsonToStdout ? stderr : stdout;
+
+        std::fprintf(table, "%-40s %14s %14s %14s\n", "benchmark", "ns/iter", "ns/item", "spread %");
+
+        std::vector<Result> results;
+        for (const Benchmark &bench : registry()) {
+            if (bench.name.find(filter) == std::string::npos)
+                continue;
+
+            Result r = run(bench);
+            std::fprintf(table, "%-40s %14.2f %14.3f %14.1f\n", r.name.c_str(),
+                         r.medianNs, r.medianNs / r.itemsPerIteration,
+                         r.medianNs > 0 ? (r.maxNs - r.minNs) / r.medianNs * 100 : 0.0);
+            std::fflush(table);
+            results.push_back(r);
+        }
+
+        if (jsonPath) {
+            std::FILE *out = jsonToStdout ? stdout : std::fopen(jsonPath, "w");
+            if (!out) {
+                std::fprintf(stderr, "cannot open %s\n", jsonPath);
+                return 1;
+            }
+            writeJson(out, results);
+            if (!jsonToStdout)
+                std::fclose(out);
+        }
+
+        return 0;
+    }
+}
+
+#define DU_BENCHMARK(group, name) \
+    static void group##_##name##_bench(DiamondBench::State &state); \
+    static DiamondBench::Registrar group##_##name##_registrar(#group, #name, group##_##name##_bench); \
+    static void group##_##name##_bench(DiamondBench::State &state)
+
+#endif // DU_BENCH_H
@@ -0,0 +1,111 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <vector>
+#include "duBench.h"
+#include "duMatrix.h"
+#include "duVector2.h"
+
+using namespace Diamond;
+using DiamondBench::doNotOptimize;
+
+namespace {
+    const size_t NUM_VECTORS = 4096;
+
+    std::vector<Vector2<float> > makeVectors() {
+        std::vector<Vector2<float> > v;
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            v.emplace_back((float)i, (float)(NUM_VECTORS - i));
+        return v;
+    }
+}
+
+DU_BENCHMARK(Vector2, AddScale) {
+    std::vector<Vector2<float> > a = makeVectors();
+    std::vector<Vector2<float> > b = makeVectors();
+    state.setItemsPerIteration(NUM_VECTORS);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            a[i] += 0.5f * b[i];
+        doNotOptimize(a.data());
+    }
+}
+
+DU_BENCHMARK(Vector2, Dot) {
+    std::vector<Vector2<float> > a = makeVectors();
+    std::vector<Vector2<float> > b = makeVectors();
+    state.setItemsPerIteration(NUM_VECTORS);
+    while (state.keepRunning()) {
+        float sum = 0;
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            sum += a[i].dot(b[i]);
+        doNotOptimize(sum);
+    }
+}
+
+DU_BENCHMARK(Vector2, Normalize) {
+    std::vector<Vector2<float> > a = makeVectors();
+    state.setItemsPerIteration(NUM_VECTORS);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            a[i].normalize();
+        doNotOptimize(a.data());
+    }
+}
+
+DU_BENCHMARK(Vector2, Rotate) {
+    std::vector<Vector2<float> > a = makeVectors();
+    state.setItemsPerIteration(NUM_VECTORS);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            a[i].rotate(0.01f);
+        doNotOptimize(a.data());
+    }
+}
+
+DU_BENCHMARK(Matrix, Mul2x2Vector) {
+    std::vector<Vector2<float> > a = makeVectors();
+    Matrix<float, 2, 2> m = {{{0.5f, 1.0f}, {-1.0f, 0.5f}}};
+    state.setItemsPerIteration(NUM_VECTORS);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < NUM_VECTORS; ++i)
+            a[i] = m.mul(a[i]);
+        doNotOptimize(a.data());
+    }
+}
+
+DU_BENCHMARK(Matrix, Inv2x2) {
+    Matrix<float, 2, 2> m = {{{4.0f, 7.0f}, {2.0f, 6.0f}}};
+    while (state.keepRunning()) {
+        doNotOptimize(m);
+        Matrix<float, 2, 2> inverse = m.sInv();
+        doNotOptimize(inverse);
+    }
+}
+
+DU_BENCHMARK(Matrix, Mul4x4) {
+    Matrix<float, 4, 4> a;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c)
+            a[r][c] = (float)(r * 4 + c);
+    }
+    Matrix<float, 4, 4> b = a;
+    while (state.keepRunning()) {
+        doNotOptimize(a);
+        Matrix<float, 4, 4> product = a.mul(b);
+        doNotOptimize(product);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <vector>
+#include "duBench.h"
+#include "duCompactPoolManager.h"
+#include "duDirectoryPoolManager.h"
+#include "duMemPool.h"
+#include "duPoolManager.h"
+#include "duVector2.h"
+
+using namespace Diamond;
+using DiamondBench::doNotOptimize;
+
+namespace {
+    const size_t WINDOW = 1024; // objects kept alive at once in the batch benchmarks
+
+    using Elem = Vector2<double>;
+}
+
+DU_BENCHMARK(NewDelete, MakeFree) {
+    while (state.keepRunning()) {
+        Elem *e = new Elem(1, 2);
+        doNotOptimize(e);
+        delete e;
+    }
+}
+
+DU_BENCHMARK(MemPool, MakeFree) {
+    MemPool<Elem> pool(256);
+    while (state.keepRunning()) {
+        Elem *e = pool.make(1, 2);
+        doNotOptimize(e);
+        pool.free(e);
+    }
+}
+
+DU_BENCHMARK(NewDelete, MakeFreeWindow) {
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = new Elem((double)i, 0);
+        doNotOptimize(window.data());
+        for (size_t i = 0; i < WINDOW; ++i)
+            delete window[i];
+    }
+}
+
+DU_BENCHMARK(MemPool, MakeFreeWindow) {
+    MemPool<Elem> pool(256, std::allocator<MemNode<Elem> >(), 4096);
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = pool.make((double)i, 0);
+        doNotOptimize(window.data());
+        for (size_t i = 0; i < WINDOW; ++i)
+            pool.free(window[i]);
+    }
+}
+
+DU_BENCHMARK(MemPool, MakeNFreeNWindow) {
+    MemPool<Elem> pool(256, std::allocator<MemNode<Elem> >(), 4096);
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        pool.makeN(WINDOW, window.data(), 0.0, 0.0);
+        doNotOptimize(window.data());
+        pool.freeN(window.data(), WINDOW);
+    }
+}
+
+// The Clear benchmarks make every element off the untouched ends of the chunks,
+// where makeN carves each batch as a single run
+DU_BENCHMARK(MemPool, MakeClearWindow) {
+    MemPool<Elem> pool(WINDOW);
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = pool.make(0.0, 0.0);
+        doNotOptimize(window.data());
+        pool.clear();
+    }
+}
+
+DU_BENCHMARK(MemPool, MakeNClearWindow) {
+    MemPool<Elem> pool(WINDOW);
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        pool.makeN(WINDOW, window.data(), 0.0, 0.0);
+        doNotOptimize(window.data());
+        pool.clear();
+    }
+}
+
+DU_BENCHMARK(DumbPoolManager, MakeFreeWindow) {
+    DumbPoolManager<Elem> manager(256, std::allocator<MemNode<Elem> >(), 4096);
+    std::vector<DumbPtr<Elem> > window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = manager.make((double)i, 0);
+        doNotOptimize(window.data());
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i].free();
+    }
+}
+
+DU_BENCHMARK(CompactPoolManager, MakeFreeWindow) {
+    CompactPoolManager<Elem> manager(256, std::allocator<MemNode<Elem> >(), 4096);
+    std::vector<CompactDumbPtr<Elem> > window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = manager.make((double)i, 0);
+        doNotOptimize(window.data());
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i].free();
+    }
+}
+
+DU_BENCHMARK(DirectoryPoolManager, MakePoolFreeWindow) {
+    DirectoryPoolManager<Elem> manager(256, 4096);
+    std::vector<Elem*> window(WINDOW);
+    state.setItemsPerIteration(WINDOW);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < WINDOW; ++i)
+            window[i] = manager.make((double)i, 0);
+        doNotOptimize(window.data());
+        for (size_t i = 0; i < WINDOW; ++i)
+            pool_free(window[i]);
+    }
+}
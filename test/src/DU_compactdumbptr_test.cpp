@@ -0,0 +1,105 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "duCompactDumbPtr.h"
+#include "duCompactPoolManager.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    void countingFree(void *context, void *ptr) {
+        delete (int*)ptr;
+        ++*(int*)context;
+    }
+}
+
+TEST(CompactDumbPtrTest, IsOnePointer) {
+    EXPECT_EQ(sizeof(CompactDumbPtr<int>), sizeof(int*));
+}
+
+TEST(CompactDumbPtrTest, FreesThroughRegistry) {
+    int freed = 0;
+    uint16_t index = DumbDeleterRegistry::add(&countingFree, &freed);
+    EXPECT_NE(index, 0);
+
+    CompactDumbPtr<int> p(new int(5), index);
+    EXPECT_EQ(*p, 5);
+    EXPECT_EQ(p.get_deleter_index(), index);
+
+    CompactDumbPtr<int> copy = p;
+    EXPECT_EQ(copy, p);
+
+    p.free();
+    EXPECT_EQ(freed, 1);
+    EXPECT_EQ(p, nullptr);
+    EXPECT_FALSE(p);
+
+    DumbDeleterRegistry::remove(index);
+}
+
+TEST(CompactDumbPtrTest, DeletesWithoutDeleter) {
+    CompactDumbPtr<Vector2<int> > p(new Vector2<int>(1, 2));
+    EXPECT_EQ(p->x, 1);
+    EXPECT_EQ(p.get_deleter_index(), 0);
+    p.free();
+    EXPECT_EQ(p, nullptr);
+}
+
+TEST(CompactDumbPtrTest, PoolManagerMakesAndFrees) {
+    CompactPoolManager<Vector2<int> > manager(4);
+
+    CompactDumbPtr<Vector2<int> > p1 = manager.make(3, 4);
+    EXPECT_EQ(p1->y, 4);
+    EXPECT_EQ(p1.get_deleter_index(), manager.deleterIndex());
+
+    Vector2<int> *raw = p1.get();
+    p1.free();
+
+    // The freed node is reused
+    CompactDumbPtr<Vector2<int> > p2 = manager.make(5, 6);
+    EXPECT_EQ(p2.get(), raw);
+    p2.free();
+}
+
+TEST(CompactDumbPtrTest, ReusesRegistryIndices) {
+    uint16_t index;
+    {
+        CompactPoolManager<int> manager;
+        index = manager.deleterIndex();
+    }
+    CompactPoolManager<int> manager;
+    EXPECT_EQ(manager.deleterIndex(), index);
+}
+
+TEST(CompactDumbPtrTest, RejectsWidePointers) {
+    int *wide = reinterpret_cast<int*>((uintptr_t)1 << 56);
+    EXPECT_THROW(CompactDumbPtr<int>(wide, 1), std::invalid_argument);
+}
+
+TEST(CompactDumbPtrTest, ComparesWithNull) {
+    int x = 0;
+    CompactDumbPtr<int> p(&x);
+    CompactDumbPtr<int> null;
+
+    EXPECT_TRUE(null == nullptr);
+    EXPECT_TRUE(nullptr != p);
+    EXPECT_TRUE(nullptr < p);
+    EXPECT_TRUE(p > nullptr);
+    EXPECT_TRUE(null <= nullptr);
+    EXPECT_TRUE(p >= nullptr);
+}
@@ -0,0 +1,146 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "duConcurrentMemPool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(ConcurrentMemPoolTest, IsLockFree) {
+    ConcurrentMemPool<Vector2<int> > vectorPool;
+    EXPECT_TRUE(vectorPool.is_lock_free());
+}
+
+TEST(ConcurrentMemPoolTest, AllocatesAndFrees) {
+    ConcurrentMemPool<Vector2<int> > vectorPool(10);
+
+    Vector2<int> *v1 = vectorPool.make(2, 3);
+
+    ASSERT_NE(v1, nullptr);
+
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    vectorPool.free(v1);
+
+    // v2 should've been given the same memory location
+    // as the last pointer that was freed (v1)
+    Vector2<int> *v2 = vectorPool.make(4, 9);
+    EXPECT_EQ(v1, v2);
+
+    EXPECT_EQ(v2->x, 4);
+    EXPECT_EQ(v2->y, 9);
+}
+
+TEST(ConcurrentMemPoolTest, AllocatesChunks) {
+    const int chunkSize = 20;
+
+    ConcurrentMemPool<Vector2<int> > vectorPool(chunkSize);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < chunkSize * 5; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    std::vector<Vector2<int>* > sorted(vecPtrs);
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    for (int i = 0; i < chunkSize * 5; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+}
+
+TEST(ConcurrentMemPoolTest, AllocatesFromThreads) {
+    const int numThreads = 8;
+    const int numObjects = 2000;
+
+    // small chunks so that threads race to grow the pool
+    ConcurrentMemPool<Vector2<int> > vectorPool(16);
+    std::vector<std::vector<Vector2<int>* > > vecPtrs(numThreads);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&vectorPool, &vecPtrs, t, numObjects]() {
+            for (int round = 0; round < 5; ++round) {
+                for (int i = 0; i < numObjects; ++i)
+                    vecPtrs[t].push_back(vectorPool.make(t, i));
+                for (int i = 0; i < numObjects; ++i) {
+                    EXPECT_EQ(vecPtrs[t][i]->x, t);
+                    EXPECT_EQ(vecPtrs[t][i]->y, i);
+                }
+                if (round < 4) {
+                    for (auto p : vecPtrs[t])
+                        vectorPool.free(p);
+                    vecPtrs[t].clear();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    // no two threads may have been handed the same node
+    std::vector<Vector2<int>* > all;
+    for (auto &ptrs : vecPtrs)
+        all.insert(all.end(), ptrs.begin(), ptrs.end());
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(std::unique(all.begin(), all.end()), all.end());
+
+    // free the remaining objects from a different thread than made them
+    std::thread freer([&vectorPool, &all]() {
+        for (auto p : all)
+            vectorPool.free(p);
+    });
+    freer.join();
+}
+
+namespace {
+    // Pretends to place every chunk above the low 48 bits of the address space
+    template <typename T>
+    struct HighAllocator {
+        using value_type = T;
+
+        HighAllocator(int *deallocated) : deallocated(deallocated) {}
+
+        template <class U>
+        HighAllocator(const HighAllocator<U> &other) : deallocated(other.deallocated) {}
+
+        T *allocate(size_t) { return reinterpret_cast<T*>((uintptr_t)1 << 52); }
+        void deallocate(T*, size_t) { ++*deallocated; }
+
+        int *deallocated;
+    };
+}
+
+TEST(ConcurrentMemPoolTest, RejectsUnpackableChunks) {
+    if (sizeof(void*) < 8)
+        return;
+
+    int deallocated = 0;
+    {
+        ConcurrentMemPool<Vector2<int>, HighAllocator<MemNode<Vector2<int> > > >
+            vectorPool(4, HighAllocator<MemNode<Vector2<int> > >(&deallocated));
+
+        EXPECT_EQ(deallocated, 1);
+        EXPECT_EQ(vectorPool.make(1, 2), nullptr);
+        EXPECT_EQ(deallocated, 2);
+    }
+}
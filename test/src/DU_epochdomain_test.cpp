@@ -0,0 +1,146 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "duEpochDomain.h"
+#include "duPoolManager.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    void countingFree(void *context, void *ptr) {
+        delete (int*)ptr;
+        ++*(int*)context;
+    }
+}
+
+TEST(EpochDomainTest, DefersWhileReading) {
+    EpochDomain domain;
+    EpochDomain::Participant writer(domain);
+    EpochDomain::Participant reader(domain);
+
+    int freed = 0;
+    {
+        EpochDomain::Guard guard(reader);
+
+        writer.retire(new int(1), &countingFree, &freed);
+        for (int i = 0; i < 10; ++i)
+            writer.collect();
+
+        // The reader holds the epoch back, so it advances at most once
+        EXPECT_EQ(freed, 0);
+        EXPECT_EQ(writer.pending(), 1u);
+    }
+
+    writer.collect();
+    writer.collect();
+    EXPECT_EQ(freed, 1);
+    EXPECT_EQ(writer.pending(), 0u);
+}
+
+TEST(EpochDomainTest, CollectsInBatches) {
+    EpochDomain domain;
+    int freed = 0;
+    {
+        EpochDomain::Participant writer(domain, 8);
+
+        for (int i = 0; i < 8; ++i)
+            writer.retire(new int(i), &countingFree, &freed);
+
+        // The batch advanced the epoch once, which is not enough to free it yet
+        EXPECT_EQ(freed, 0);
+
+        for (int i = 0; i < 8; ++i)
+            writer.retire(new int(i), &countingFree, &freed);
+
+        // The second batch freed at least the first
+        EXPECT_GE(freed, 8);
+        EXPECT_EQ(freed + writer.pending(), 16u);
+    }
+
+    // Destroying the participant frees the rest
+    EXPECT_EQ(freed, 16);
+}
+
+TEST(EpochDomainTest, RetiresDumbPtrs) {
+    EpochDomain domain;
+    DumbPoolManager<Vector2<int> > manager(4);
+    {
+        EpochDomain::Participant writer(domain);
+
+        DumbPtr<Vector2<int> > p = manager.make(1, 2);
+        Vector2<int> *raw = p.get();
+        writer.retire(p);
+        writer.collect();
+        writer.collect();
+
+        // Back in the pool
+        DumbPtr<Vector2<int> > q = manager.make(3, 4);
+        EXPECT_EQ(q.get(), raw);
+        writer.retire(q);
+    }
+}
+
+TEST(EpochDomainTest, ReadsWhileFreeing) {
+    const size_t SLOTS = 16;
+
+    EpochDomain domain;
+    DumbPoolManager<Vector2<int> > manager(64);
+    std::atomic<Vector2<int>*> slots[SLOTS];
+    const DumbDeleter *deleter = nullptr;
+
+    for (size_t i = 0; i < SLOTS; ++i) {
+        DumbPtr<Vector2<int> > p = manager.make(0, 0);
+        deleter = p.get_deleter();
+        slots[i].store(p.get());
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&]() {
+            EpochDomain::Participant reader(domain);
+            while (!done.load()) {
+                EpochDomain::Guard guard(reader);
+                for (size_t i = 0; i < SLOTS; ++i) {
+                    Vector2<int> *v = slots[i].load(std::memory_order_acquire);
+                    EXPECT_EQ(v->x, -v->y);
+                }
+            }
+        });
+    }
+
+    // Only this thread makes and frees, so the pool needs no lock
+    {
+        EpochDomain::Participant writer(domain, 16);
+        for (int n = 1; n <= 20000; ++n) {
+            DumbPtr<Vector2<int> > p = manager.make(n, -n);
+            Vector2<int> *old = slots[n % SLOTS].exchange(p.get(), std::memory_order_acq_rel);
+            writer.retire(DumbPtr<Vector2<int> >(old, deleter));
+        }
+
+        done.store(true);
+        for (auto &reader : readers)
+            reader.join();
+
+        for (size_t i = 0; i < SLOTS; ++i)
+            writer.retire(DumbPtr<Vector2<int> >(slots[i].load(), deleter));
+    }
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <cstdint>
+#include "duFrameArena.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    struct Tracked {
+        Tracked(int id, int *log, int *count) : id(id), log(log), count(count) {}
+        ~Tracked() { log[(*count)++] = id; }
+
+        int id;
+        int *log;
+        int *count;
+    };
+}
+
+TEST(FrameArenaTest, MakesAndResets) {
+    FrameArena arena(256);
+
+    Vector2<int> *v1 = arena.make<Vector2<int> >(2, 3);
+    Vector2<int> *v2 = arena.make<Vector2<int> >(4, 5);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+    EXPECT_EQ(v2->x, 4);
+    EXPECT_EQ(v2, v1 + 1);
+
+    arena.reset();
+    EXPECT_EQ(arena.make<Vector2<int> >(6, 7), v1);
+    EXPECT_EQ(arena.blockCount(), 1);
+}
+
+TEST(FrameArenaTest, AlignsAndGrows) {
+    FrameArena arena(256);
+
+    for (int i = 0; i < 100; ++i) {
+        void *p = arena.allocate(24, 32);
+        EXPECT_EQ((uintptr_t)p % 32, 0);
+    }
+    size_t blocks = arena.blockCount();
+    EXPECT_GT(blocks, 1);
+
+    // Bigger than a block
+    void *big = arena.allocate(1000);
+    EXPECT_NE(big, nullptr);
+    EXPECT_EQ(arena.blockCount(), blocks + 1);
+
+    // The same frame again reuses every block
+    arena.reset();
+    for (int i = 0; i < 100; ++i)
+        arena.allocate(24, 32);
+    arena.allocate(1000);
+    EXPECT_EQ(arena.blockCount(), blocks + 1);
+}
+
+TEST(FrameArenaTest, CallsDestructorsOnReset) {
+    int log[3];
+    int count = 0;
+
+    FrameArena arena;
+    arena.make<Tracked>(1, log, &count);
+    arena.make<Tracked>(2, log, &count);
+    arena.make<Tracked>(3, log, &count);
+    EXPECT_EQ(count, 0);
+
+    arena.reset();
+    ASSERT_EQ(count, 3);
+    EXPECT_EQ(log[0], 3);
+    EXPECT_EQ(log[1], 2);
+    EXPECT_EQ(log[2], 1);
+
+    arena.reset();
+    EXPECT_EQ(count, 3);
+}
+
+TEST(FrameArenaTest, DoubleBuffers) {
+    int log[2];
+    int count = 0;
+
+    DoubleBufferedFrameArena arena(256);
+
+    Tracked *first = arena.make<Tracked>(1, log, &count);
+    arena.nextFrame();
+    Tracked *second = arena.make<Tracked>(2, log, &count);
+
+    // Made last frame and still valid
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(first->id, 1);
+    EXPECT_NE(&arena.current(), &arena.previous());
+
+    arena.nextFrame();
+    ASSERT_EQ(count, 1);
+    EXPECT_EQ(log[0], 1);
+    EXPECT_EQ(second->id, 2);
+
+    arena.nextFrame();
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(log[1], 2);
+}
@@ -0,0 +1,161 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <stdexcept>
+#include <vector>
+#include "duHandlePool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(HandlePoolTest, MakesAndResolves) {
+    HandlePool<Vector2<int> > vectorPool(10);
+
+    static_assert(sizeof(PoolHandle<Vector2<int> >) == 4, "Handles must be 32 bits");
+
+    PoolHandle<Vector2<int> > h1 = vectorPool.make(2, 3);
+    ASSERT_TRUE(h1);
+    ASSERT_TRUE(vectorPool.valid(h1));
+
+    Vector2<int> *v1 = vectorPool.get(h1);
+    ASSERT_NE(v1, nullptr);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+    EXPECT_EQ(vectorPool.handleOf(v1), h1);
+
+    EXPECT_FALSE(PoolHandle<Vector2<int> >());
+    EXPECT_EQ(vectorPool.get(PoolHandle<Vector2<int> >()), nullptr);
+}
+
+TEST(HandlePoolTest, DetectsStaleHandles) {
+    HandlePool<Vector2<int> > vectorPool(10);
+
+    PoolHandle<Vector2<int> > h1 = vectorPool.make(2, 3);
+    Vector2<int> *v1 = vectorPool.get(h1);
+    vectorPool.free(h1);
+
+    EXPECT_FALSE(vectorPool.valid(h1));
+    EXPECT_EQ(vectorPool.get(h1), nullptr);
+
+    // The slot is reused under a new generation
+    PoolHandle<Vector2<int> > h2 = vectorPool.make(4, 5);
+    EXPECT_EQ(vectorPool.get(h2), v1);
+    EXPECT_EQ(h2.chunk(), h1.chunk());
+    EXPECT_EQ(h2.slot(), h1.slot());
+    EXPECT_NE(h2.generation(), h1.generation());
+    EXPECT_EQ(vectorPool.get(h1), nullptr);
+
+    // Freeing through a stale handle does nothing
+    vectorPool.free(h1);
+    EXPECT_EQ(vectorPool.get(h2)->x, 4);
+}
+
+TEST(HandlePoolTest, SpansChunks) {
+    HandlePool<Vector2<int> > vectorPool(8, std::allocator<MemNode<Vector2<int> > >(), 8);
+
+    std::vector<PoolHandle<Vector2<int> > > handles;
+    for (int i = 0; i < 40; ++i)
+        handles.push_back(vectorPool.make(i, -i));
+
+    EXPECT_EQ(vectorPool.chunkCount(), 5);
+    EXPECT_EQ(handles.back().chunk(), 4);
+
+    for (int i = 0; i < 40; ++i) {
+        Vector2<int> *v = vectorPool.get(handles[i]);
+        ASSERT_NE(v, nullptr);
+        EXPECT_EQ(v->x, i);
+        EXPECT_EQ(v->y, -i);
+    }
+}
+
+TEST(HandlePoolTest, LimitsChunks) {
+    HandlePool<Vector2<int> > vectorPool(1, std::allocator<MemNode<Vector2<int> > >(), 1);
+
+    for (size_t i = 0; i < HandlePool<Vector2<int> >::MAX_CHUNKS; ++i)
+        ASSERT_TRUE(vectorPool.make(1, 1));
+
+    PoolHandle<Vector2<int> > full = vectorPool.make(1, 1);
+    EXPECT_FALSE(full);
+}
+
+namespace {
+    struct Throwing {
+        Throwing(bool fail) {
+            if (fail)
+                throw std::runtime_error("construction failed");
+        }
+    };
+}
+
+TEST(HandlePoolTest, ReusesSlotsOfThrowingConstructors) {
+    HandlePool<Throwing> pool(1, std::allocator<MemNode<Throwing> >(), 1);
+
+    EXPECT_THROW(pool.make(true), std::runtime_error);
+
+    // The slot was never live, so it is handed out again without growing
+    PoolHandle<Throwing> h = pool.make(false);
+    EXPECT_TRUE(pool.valid(h));
+    EXPECT_EQ(h.slot(), 0);
+    EXPECT_EQ(pool.chunkCount(), 1u);
+
+    int visited = 0;
+    pool.for_each_live([&visited](Throwing&) { ++visited; });
+    EXPECT_EQ(visited, 1);
+}
+
+TEST(HandlePoolTest, RejectsUnallocatedSlots) {
+    HandlePool<Vector2<int> > vectorPool(10);
+
+    PoolHandle<Vector2<int> > h1 = vectorPool.make(2, 3);
+
+    // A made-up handle to a slot that has never been handed out
+    PoolHandle<Vector2<int> > fake(1, h1.chunk(), h1.slot() + 1);
+    EXPECT_FALSE(vectorPool.valid(fake));
+    EXPECT_EQ(vectorPool.get(fake), nullptr);
+
+    // or to a slot that has been freed
+    vectorPool.free(h1);
+    EXPECT_FALSE(vectorPool.valid(PoolHandle<Vector2<int> >(2, h1.chunk(), h1.slot())));
+}
+
+TEST(HandlePoolTest, RetiresExhaustedSlots) {
+    HandlePool<Vector2<int> > vectorPool(10);
+
+    PoolHandle<Vector2<int> > first = vectorPool.make(0, 0);
+    PoolHandle<Vector2<int> > last = first;
+    vectorPool.free(first);
+
+    // The free list hands the same slot back every time until its generations run out
+    for (int i = 1; i < 2048; ++i) {
+        last = vectorPool.make(i, i);
+        ASSERT_EQ(last.slot(), first.slot());
+        EXPECT_FALSE(vectorPool.valid(first));
+        vectorPool.free(last);
+    }
+
+    PoolHandle<Vector2<int> > next = vectorPool.make(-1, -1);
+    EXPECT_NE(next.slot(), first.slot());
+    EXPECT_FALSE(vectorPool.valid(first));
+    EXPECT_FALSE(vectorPool.valid(last));
+
+    int visited = 0;
+    vectorPool.for_each_live([&visited](Vector2<int> &v) {
+        EXPECT_EQ(v.x, -1);
+        ++visited;
+    });
+    EXPECT_EQ(visited, 1);
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <new>
+#include <vector>
+#include "duHugePageAllocator.h"
+#include "duMemPool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(HugePageAllocatorTest, AllocatesAligned) {
+    HugePageArena arena(8 * 1024 * 1024);
+
+    char *first = (char*)arena.allocate(10, 1);
+    EXPECT_EQ((uintptr_t)first % (2 * 1024 * 1024), 0u);
+
+    char *second = (char*)arena.allocate(100, 64);
+    EXPECT_EQ((uintptr_t)second % 64, 0u);
+    EXPECT_EQ(second, first + 64);
+
+    // memory is usable
+    for (int i = 0; i < 100; ++i)
+        second[i] = (char)i;
+    EXPECT_EQ(second[99], 99);
+
+    EXPECT_EQ(arena.used(), 164u);
+}
+
+TEST(HugePageAllocatorTest, ThrowsWhenExhausted) {
+    HugePageArena arena(2 * 1024 * 1024);
+
+    arena.allocate(1024 * 1024, 8);
+    EXPECT_THROW(arena.allocate(2 * 1024 * 1024, 8), std::bad_alloc);
+}
+
+TEST(HugePageAllocatorTest, ReusesMostRecentAllocation) {
+    HugePageArena arena(8 * 1024 * 1024);
+
+    char *first = (char*)arena.allocate(3 * 1024 * 1024, 8);
+    char *second = (char*)arena.allocate(1024 * 1024, 8);
+
+    // Older allocations keep their address space
+    arena.deallocate(first, 3 * 1024 * 1024);
+    EXPECT_EQ(arena.used(), 4u * 1024 * 1024);
+
+    arena.deallocate(second, 1024 * 1024);
+    EXPECT_EQ(arena.used(), 3u * 1024 * 1024);
+    EXPECT_EQ(arena.allocate(1024 * 1024, 8), second);
+}
+
+TEST(HugePageAllocatorTest, RejectsOversizedReservations) {
+    EXPECT_THROW(HugePageArena arena((size_t)-1), std::bad_alloc);
+
+    size_t defaultBytes = HugePageArena::DEFAULT_RESERVE_BYTES;
+    EXPECT_EQ(defaultBytes % HugePageArena::HUGE_PAGE_SIZE, 0u);
+}
+
+TEST(HugePageAllocatorTest, BacksMemPool) {
+    auto arena = std::make_shared<HugePageArena>(64 * 1024 * 1024);
+
+    using Allocator = HugePageAllocator<MemNode<Vector2<int> > >;
+    MemPool<Vector2<int>, Allocator> pool1(1024, Allocator(arena));
+    MemPool<Vector2<int>, Allocator> pool2(1024, Allocator(arena));
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 5000; ++i) {
+        vecPtrs.push_back(pool1.make(i, -i));
+        vecPtrs.push_back(pool2.make(-i, i));
+    }
+
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(vecPtrs[2 * i]->x, i);
+        EXPECT_EQ(vecPtrs[2 * i + 1]->x, -i);
+    }
+
+    // both pools carve their chunks out of the shared arena
+    EXPECT_GE(arena->used(), 10240 * sizeof(MemNode<Vector2<int> >));
+    EXPECT_LE(arena->used(), arena->reserved());
+}
+
+TEST(HugePageAllocatorTest, ComparesByArena) {
+    HugePageAllocator<int> a(std::make_shared<HugePageArena>(2 * 1024 * 1024));
+    HugePageAllocator<double> b(a);
+    HugePageAllocator<int> c(std::make_shared<HugePageArena>(2 * 1024 * 1024));
+
+    EXPECT_TRUE(a == b);
+    EXPECT_TRUE(a != c);
+}
+
+#endif
@@ -14,6 +14,8 @@
     limitations under the License.
 */
 
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include "duMemPool.h"
 #include "duVector2.h"
@@ -224,3 +226,480 @@ TEST(MemPoolTest, AllocatesChunks) {
         }
     }
 }
+
+
+struct alignas(32) WideVec {
+    WideVec(float v = 0) { for (auto &f : lanes) f = v; }
+
+    float lanes[8];
+};
+
+TEST(MemPoolTest, AlignsOverAlignedTypes) {
+    AlignedMemPool<WideVec, alignof(WideVec)> widePool(3);
+
+    std::vector<WideVec*> widePtrs;
+    for (int i = 0; i < 10; ++i) {
+        widePtrs.push_back(widePool.make((float)i));
+        EXPECT_EQ((uintptr_t)widePtrs[i] % 32, 0u);
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(widePtrs[i]->lanes[0], (float)i);
+        EXPECT_EQ(widePtrs[i]->lanes[7], (float)i);
+        widePool.free(widePtrs[i]);
+    }
+}
+
+TEST(MemPoolTest, PadsToCacheLines) {
+    AlignedMemPool<int> intPool(4);
+
+    EXPECT_EQ(sizeof(AlignedMemPool<int>::TNode), CACHE_LINE_SIZE);
+
+    std::vector<int*> intPtrs;
+    for (int i = 0; i < 10; ++i) {
+        intPtrs.push_back(intPool.make(i));
+        EXPECT_EQ((uintptr_t)intPtrs[i] % CACHE_LINE_SIZE, 0u);
+    }
+
+    // slots within a chunk are exactly one cache line apart
+    for (int i = 1; i < 4; ++i)
+        EXPECT_EQ((char*)intPtrs[i] - (char*)intPtrs[i - 1], (ptrdiff_t)CACHE_LINE_SIZE);
+
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(*intPtrs[i], i);
+}
+
+TEST(MemPoolTest, GrowsGeometrically) {
+    MemPool<Vector2<int> > vectorPool(4, std::allocator<MemNode<Vector2<int> > >(), 64);
+
+    EXPECT_EQ(vectorPool.chunkCount(), 1u);
+    EXPECT_EQ(vectorPool.capacity(), 4u);
+
+    // chunks of 4, 8, 16, 32, 64 then 64 again
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 4 + 8 + 16 + 32 + 64 + 1; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    EXPECT_EQ(vectorPool.chunkCount(), 6u);
+    EXPECT_EQ(vectorPool.capacity(), 4u + 8 + 16 + 32 + 64 + 64);
+
+    for (int i = 0; i < (int)vecPtrs.size(); ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+}
+
+TEST(MemPoolTest, GrowsByFixedChunks) {
+    MemPool<Vector2<int> > vectorPool(5);
+
+    for (int i = 0; i < 12; ++i)
+        vectorPool.make(i, i);
+
+    EXPECT_EQ(vectorPool.chunkCount(), 3u);
+    EXPECT_EQ(vectorPool.capacity(), 15u);
+}
+
+TEST(MemPoolTest, MakesAndFreesBatches) {
+    const int chunkSize = 8;
+
+    MemPool<Vector2<int> > vectorPool(chunkSize);
+
+    // use up part of the first chunk so that the batch
+    // comes partly from the free list and partly from a new chunk
+    Vector2<int> *first = vectorPool.make(-1, -1);
+
+    Vector2<int> *batch[50];
+    EXPECT_EQ(vectorPool.makeN(50, batch, 7, 9), 50u);
+
+    // 7 nodes from the first chunk, then one run of 43 from a second chunk
+    EXPECT_EQ(vectorPool.chunkCount(), 2u);
+    for (int i = 8; i < 50; ++i)
+        EXPECT_EQ(batch[i], batch[i - 1] + 1);
+
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_NE(batch[i], first);
+        EXPECT_EQ(batch[i]->x, 7);
+        EXPECT_EQ(batch[i]->y, 9);
+    }
+
+    vectorPool.freeN(batch, 50);
+
+    // the freed batch is reused before anything new is allocated
+    Vector2<int> *again[50];
+    EXPECT_EQ(vectorPool.makeN(50, again, 1, 2), 50u);
+    EXPECT_EQ(vectorPool.chunkCount(), 2u);
+
+    std::sort(batch, batch + 50);
+    std::sort(again, again + 50);
+    for (int i = 0; i < 50; ++i)
+        EXPECT_EQ(batch[i], again[i]);
+
+    EXPECT_EQ(first->x, -1);
+    EXPECT_EQ(first->y, -1);
+}
+
+TEST(MemPoolTest, MakesBatchesFromUntouchedChunks) {
+    MemPool<Vector2<int> > vectorPool(16);
+
+    Vector2<int> *batch[16];
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(vectorPool.makeN(16, batch, i, i), 16u);
+        vectorPool.clear();
+    }
+
+    // every batch is carved from the first chunk again after clearing it
+    EXPECT_EQ(vectorPool.chunkCount(), 1u);
+}
+
+namespace {
+    // Its constructor throws once budget constructions have succeeded
+    struct Budgeted {
+        Budgeted(int *budget) {
+            if ((*budget)-- == 0)
+                throw std::runtime_error("out of budget");
+        }
+
+        int value[2];
+    };
+}
+
+TEST(MemPoolTest, UndoesThrowingBatches) {
+    MemPool<Budgeted> pool(8);
+
+    // a batch from the free list
+    Budgeted *batch[8];
+    int budget = 8;
+    EXPECT_EQ(pool.makeN(8, batch, &budget), 8u);
+    pool.freeN(batch, 8);
+
+    budget = 3;
+    EXPECT_THROW(pool.makeN(6, batch, &budget), std::runtime_error);
+
+    // a batch that empties the free list and throws in the run carved from a new chunk
+    budget = 8 + 5;
+    Budgeted *run[16];
+    EXPECT_THROW(pool.makeN(16, run, &budget), std::runtime_error);
+
+    // every node that was taken is free again and both chunks fill up
+    // without any node being handed out twice
+    std::vector<Budgeted*> ptrs;
+    budget = 100;
+    for (int i = 0; i < 16; ++i)
+        ptrs.push_back(pool.make(&budget));
+
+    std::sort(ptrs.begin(), ptrs.end());
+    EXPECT_EQ(std::unique(ptrs.begin(), ptrs.end()), ptrs.end());
+    EXPECT_EQ(pool.chunkCount(), 2u);
+#ifdef DU_MEMPOOL_STATS
+    EXPECT_EQ(pool.stats().liveObjects, 16u);
+#endif
+
+    int visited = 0;
+    pool.for_each_live([&visited](Budgeted&) { ++visited; });
+    EXPECT_EQ(visited, 16);
+}
+
+#ifdef DU_MEMPOOL_STATS
+TEST(MemPoolTest, CountsStats) {
+    MemPool<Vector2<int> > vectorPool(4, std::allocator<MemNode<Vector2<int> > >(), 8);
+
+    MemPoolStats stats = vectorPool.stats();
+    EXPECT_EQ(stats.liveObjects, 0u);
+    EXPECT_EQ(stats.chunksAllocated, 1u);
+    EXPECT_EQ(stats.growthEvents, 1u);
+    EXPECT_EQ(stats.bytesReserved, 4 * sizeof(MemNode<Vector2<int> >));
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 10; ++i)
+        vecPtrs.push_back(vectorPool.make(i, i));
+
+    stats = vectorPool.stats();
+    EXPECT_EQ(stats.liveObjects, 10u);
+    EXPECT_EQ(stats.peakLiveObjects, 10u);
+    EXPECT_EQ(stats.makeCount, 10u);
+    EXPECT_EQ(stats.chunksAllocated, 2u); // 4 + 8
+    EXPECT_EQ(stats.bytesReserved, 12 * sizeof(MemNode<Vector2<int> >));
+    EXPECT_EQ(stats.bytesUsed, 10 * sizeof(MemNode<Vector2<int> >));
+
+    for (int i = 0; i < 5; ++i)
+        vectorPool.free(vecPtrs[i]);
+    vectorPool.freeN(&vecPtrs[5], 3);
+
+    // 10 from the free list, then a run of 4 from a new chunk
+    Vector2<int> *batch[14];
+    vectorPool.makeN(14, batch, 0, 0);
+
+    stats = vectorPool.stats();
+    EXPECT_EQ(stats.liveObjects, 16u);
+    EXPECT_EQ(stats.peakLiveObjects, 16u);
+    EXPECT_EQ(stats.makeCount, 24u);
+    EXPECT_EQ(stats.freeCount, 8u);
+    EXPECT_EQ(stats.growthEvents, 3u);
+    EXPECT_EQ(stats.chunksAllocated, 3u);
+}
+#endif
+
+TEST(MemPoolTest, BumpsUntouchedNodes) {
+    MemPool<Vector2<int> > vectorPool(8);
+
+    Vector2<int> *v1 = vectorPool.make(1, 1);
+    Vector2<int> *v2 = vectorPool.make(2, 2);
+    Vector2<int> *v3 = vectorPool.make(3, 3);
+
+    // Fresh nodes are handed out in address order
+    EXPECT_EQ(v2, v1 + 1);
+    EXPECT_EQ(v3, v2 + 1);
+
+    // Recycled nodes are handed out before untouched ones
+    vectorPool.free(v2);
+    EXPECT_EQ(vectorPool.make(4, 4), v2);
+    EXPECT_EQ(vectorPool.make(5, 5), v3 + 1);
+
+    // Cleared chunks are bumped from the start again
+    vectorPool.clear();
+    EXPECT_EQ(vectorPool.make(6, 6), v1);
+    EXPECT_EQ(vectorPool.make(7, 7), v2);
+    EXPECT_EQ(vectorPool.chunkCount(), 1);
+}
+
+TEST(MemPoolTest, Reserves) {
+    MemPool<Vector2<int> > vectorPool(4);
+
+    ASSERT_TRUE(vectorPool.reserve(100, true));
+    EXPECT_EQ(vectorPool.chunkCount(), 2);
+    EXPECT_GE(vectorPool.capacity(), 100);
+
+    // Already reserved
+    ASSERT_TRUE(vectorPool.reserve(50));
+    EXPECT_EQ(vectorPool.chunkCount(), 2);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 100; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+    EXPECT_EQ(vectorPool.chunkCount(), 2);
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+
+    // Prefaulting leaves live elements untouched
+    ASSERT_TRUE(vectorPool.reserve(0, true));
+    EXPECT_EQ(vecPtrs[99]->x, 99);
+
+    for (Vector2<int> *v : vecPtrs)
+        vectorPool.free(v);
+}
+
+TEST(MemPoolTest, TrimsFreeChunks) {
+    MemPool<Vector2<int> > vectorPool(4);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 16; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    EXPECT_EQ(vectorPool.chunkCount(), 4u);
+
+    // nothing to trim while every chunk has live elements
+    vectorPool.free(vecPtrs[0]);
+    EXPECT_EQ(vectorPool.trim(), 0u);
+    vecPtrs[0] = vectorPool.make(0, 0);
+
+    // empty the second and fourth chunks, and part of the third
+    for (int i = 4; i < 8; ++i)
+        vectorPool.free(vecPtrs[i]);
+    vectorPool.freeN(&vecPtrs[12], 4);
+    vectorPool.free(vecPtrs[9]);
+
+    EXPECT_EQ(vectorPool.trim(), 2u);
+    EXPECT_EQ(vectorPool.chunkCount(), 2u);
+    EXPECT_EQ(vectorPool.capacity(), 8u);
+
+#ifdef DU_MEMPOOL_STATS
+    EXPECT_EQ(vectorPool.stats().chunksAllocated, 2u);
+    EXPECT_EQ(vectorPool.stats().bytesReserved, 8 * sizeof(MemNode<Vector2<int> >));
+    EXPECT_EQ(vectorPool.stats().liveObjects, 7u);
+#endif
+
+    // the remaining free node comes from the third chunk,
+    // and the pool grows again after that
+    Vector2<int> *v = vectorPool.make(9, -9);
+    EXPECT_EQ(v, vecPtrs[9]);
+    for (int i = 0; i < 10; ++i)
+        vecPtrs.push_back(vectorPool.make(100 + i, 0));
+    EXPECT_EQ(vectorPool.chunkCount(), 5u);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+    for (int i = 8; i < 12; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(vecPtrs[16 + i]->x, 100 + i);
+}
+
+TEST(MemPoolTest, TrimsInSteps) {
+    MemPool<Vector2<int> > vectorPool(4);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 16; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    // empty the second and fourth chunks, and part of the third
+    for (int i = 4; i < 8; ++i)
+        vectorPool.free(vecPtrs[i]);
+    vectorPool.freeN(&vecPtrs[12], 4);
+    vectorPool.free(vecPtrs[9]);
+
+    // 9 free nodes are sorted 4 at a time
+    EXPECT_EQ(vectorPool.trimStep(4), 0u);
+    EXPECT_TRUE(vectorPool.trimming());
+
+    // elements made and freed during the pass use the nodes freed since it started
+    // and are still live when it ends
+    vectorPool.free(vecPtrs[10]);
+    EXPECT_EQ(vectorPool.make(10, -10), vecPtrs[10]);
+
+    int visited = 0;
+    vectorPool.for_each_live([&visited](Vector2<int>&) { ++visited; });
+    EXPECT_EQ(visited, 7);
+
+    EXPECT_EQ(vectorPool.trimStep(4), 0u);
+    EXPECT_EQ(vectorPool.trimStep(4), 2u);
+    EXPECT_FALSE(vectorPool.trimming());
+    EXPECT_EQ(vectorPool.chunkCount(), 2u);
+
+    // the free node of the third chunk was relinked
+    EXPECT_EQ(vectorPool.make(9, -9), vecPtrs[9]);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(vecPtrs[i]->x, i);
+    for (int i = 10; i < 12; ++i)
+        EXPECT_EQ(vecPtrs[i]->x, i);
+}
+
+TEST(MemPoolTest, AbandonsTrimsWhenNodesRunOut) {
+    MemPool<Vector2<int> > vectorPool(8);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 8; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+    vectorPool.freeN(vecPtrs.data(), 8);
+
+    // the parked nodes are taken back instead of growing the pool
+    EXPECT_EQ(vectorPool.trimStep(2), 0u);
+    for (int i = 0; i < 8; ++i)
+        vecPtrs[i] = vectorPool.make(i, i);
+    EXPECT_FALSE(vectorPool.trimming());
+    EXPECT_EQ(vectorPool.chunkCount(), 1u);
+
+    // likewise for batches
+    vectorPool.freeN(vecPtrs.data(), 8);
+    EXPECT_EQ(vectorPool.trimStep(2), 0u);
+    EXPECT_EQ(vectorPool.makeN(8, vecPtrs.data(), 1, 1), 8u);
+    EXPECT_FALSE(vectorPool.trimming());
+    EXPECT_EQ(vectorPool.chunkCount(), 1u);
+
+    std::sort(vecPtrs.begin(), vecPtrs.end());
+    EXPECT_EQ(std::unique(vecPtrs.begin(), vecPtrs.end()), vecPtrs.end());
+
+    // trim() finishes the pass in progress
+    vectorPool.freeN(vecPtrs.data(), 8);
+    EXPECT_EQ(vectorPool.trimStep(2), 0u);
+    EXPECT_EQ(vectorPool.trim(), 1u);
+    EXPECT_EQ(vectorPool.chunkCount(), 0u);
+}
+
+TEST(MemPoolTest, IteratesLiveElements) {
+    MemPool<Vector2<int> > vectorPool(8, std::allocator<MemNode<Vector2<int> > >(), 128);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 200; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    // free everything except multiples of 3
+    for (int i = 0; i < 200; ++i) {
+        if (i % 3 != 0)
+            vectorPool.free(vecPtrs[i]);
+    }
+
+    std::vector<int> visited;
+    vectorPool.for_each_live([&visited](Vector2<int> &v) {
+        EXPECT_EQ(v.y, -v.x);
+        visited.push_back(v.x);
+    });
+
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(visited.size(), 67u);
+    for (int i = 0; i < 67; ++i)
+        EXPECT_EQ(visited[i], 3 * i);
+}
+
+namespace {
+    // If budget is given, its constructor throws once budget constructions have succeeded
+    struct Counted {
+        Counted(int *destroyed, int *budget = nullptr) : destroyed(destroyed) {
+            if (budget && (*budget)-- == 0)
+                throw std::runtime_error("out of budget");
+        }
+        ~Counted() { ++*destroyed; }
+
+        int *destroyed;
+    };
+}
+
+TEST(MemPoolTest, DestroysAll) {
+    int destroyed = 0;
+    MemPool<Counted> countedPool(4);
+
+    std::vector<Counted*> ptrs;
+    for (int i = 0; i < 10; ++i)
+        ptrs.push_back(countedPool.make(&destroyed));
+
+    countedPool.free(ptrs[3]);
+    EXPECT_EQ(destroyed, 1);
+
+    // an element whose constructor throws is not live
+    int budget = 0;
+    EXPECT_THROW(countedPool.make(&destroyed, &budget), std::runtime_error);
+#ifdef DU_MEMPOOL_STATS
+    EXPECT_EQ(countedPool.stats().liveObjects, 9u);
+#endif
+
+    countedPool.destroy_all();
+    EXPECT_EQ(destroyed, 10);
+
+    int visited = 0;
+    countedPool.for_each_live([&visited](Counted&) { ++visited; });
+    EXPECT_EQ(visited, 0);
+}
+
+TEST(MemPoolTest, Clears) {
+    MemPool<Vector2<int> > vectorPool(4);
+
+    for (int i = 0; i < 12; ++i)
+        vectorPool.make(i, i);
+
+    vectorPool.clear();
+
+    // all 12 nodes can be reused without growing
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 12; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+    EXPECT_EQ(vectorPool.chunkCount(), 3u);
+
+    std::vector<Vector2<int>* > sorted(vecPtrs);
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    for (int i = 0; i < 12; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+    }
+
+#ifdef DU_MEMPOOL_STATS
+    EXPECT_EQ(vectorPool.stats().liveObjects, 12u);
+#endif
+}
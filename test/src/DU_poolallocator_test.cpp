@@ -0,0 +1,123 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "duPoolAllocator.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    struct Incomplete;
+
+    // Only needs to compile: the allocator must not require a complete type
+    struct HoldsIncomplete {
+        std::list<Incomplete, PoolAllocator<Incomplete> > *list;
+        PoolAllocator<Incomplete> allocator;
+    };
+}
+
+TEST(PoolAllocatorTest, ReusesSingleObjects) {
+    PoolAllocator<Vector2<int> > allocator(8);
+
+    Vector2<int> *v1 = allocator.allocate(1);
+    Vector2<int> *v2 = allocator.allocate(1);
+    EXPECT_NE(v1, v2);
+
+    allocator.deallocate(v1, 1);
+    EXPECT_EQ(allocator.allocate(1), v1);
+
+    allocator.deallocate(v1, 1);
+    allocator.deallocate(v2, 1);
+
+    Vector2<int> *arr = allocator.allocate(16);
+    arr[15] = Vector2<int>(1, 2);
+    allocator.deallocate(arr, 16);
+
+    EXPECT_EQ(allocator.state()->poolCount(), 1);
+}
+
+TEST(PoolAllocatorTest, SharesPoolsBetweenCopies) {
+    PoolAllocator<int> a;
+    PoolAllocator<double> b(a);
+    PoolAllocator<int> c;
+
+    EXPECT_TRUE(a == b);
+    EXPECT_FALSE(a == c);
+    EXPECT_TRUE(a != c);
+
+    double *d = b.allocate(1);
+    PoolAllocator<double> e(a);
+    e.deallocate(d, 1);
+    EXPECT_EQ(b.allocate(1), d);
+    b.deallocate(d, 1);
+}
+
+TEST(PoolAllocatorTest, BacksContainers) {
+    PoolAllocator<int> allocator(32);
+
+    std::list<Vector2<int>, PoolAllocator<Vector2<int> > > list(allocator);
+    std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int> > > map(
+        std::less<int>(), allocator);
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                       PoolAllocator<std::pair<const int, int> > > hashMap(
+        16, std::hash<int>(), std::equal_to<int>(), allocator);
+
+    for (int i = 0; i < 500; ++i) {
+        list.emplace_back(i, -i);
+        map[i] = 2 * i;
+        hashMap[i] = 3 * i;
+    }
+    for (int i = 0; i < 500; i += 2) {
+        map.erase(i);
+        hashMap.erase(i);
+    }
+    list.remove_if([](const Vector2<int> &v) { return v.x % 2 == 0; });
+
+    EXPECT_EQ(list.size(), 250);
+    EXPECT_EQ(map.size(), 250);
+    EXPECT_EQ(hashMap.size(), 250);
+
+    int i = 1;
+    for (const Vector2<int> &v : list) {
+        EXPECT_EQ(v.x, i);
+        EXPECT_EQ(v.y, -i);
+        EXPECT_EQ(map[i], 2 * i);
+        EXPECT_EQ(hashMap[i], 3 * i);
+        i += 2;
+    }
+
+    EXPECT_GE(allocator.state()->poolCount(), 2);
+}
+
+TEST(PoolAllocatorTest, GrowsChunksByDefault) {
+    PoolAllocator<double> allocator(32);
+
+    std::vector<double*> ptrs;
+    for (int i = 0; i < 32 + 64; ++i)
+        ptrs.push_back(allocator.allocate(1));
+
+    // Chunks double from 32 like those of a default constructed allocator
+    auto pool = allocator.state()->pool<sizeof(double), alignof(double)>();
+    EXPECT_EQ(pool->chunkCount(), 2);
+
+    for (double *p : ptrs)
+        allocator.deallocate(p, 1);
+}
@@ -0,0 +1,118 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "duDirectoryPoolManager.h"
+#include "duPoolDirectory.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(PoolDirectoryTest, MapsPages) {
+    alignas(4096) static char region[3 * 4096];
+
+    EXPECT_EQ(PoolDirectory::find(region), 0);
+
+    PoolDirectory::insert(region, 2 * 4096, 7);
+    EXPECT_EQ(PoolDirectory::find(region), 7);
+    EXPECT_EQ(PoolDirectory::find(region + 4096 + 100), 7);
+    EXPECT_EQ(PoolDirectory::find(region + 2 * 4096), 0);
+
+    PoolDirectory::erase(region, 2 * 4096);
+    EXPECT_EQ(PoolDirectory::find(region), 0);
+    EXPECT_EQ(PoolDirectory::find(region + 4096), 0);
+}
+
+TEST(PoolDirectoryTest, FreesWithoutKnowingPool) {
+    DirectoryPoolManager<Vector2<int> > vectors(16);
+    DirectoryPoolManager<double> doubles(16);
+
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100; ++i) {
+        ptrs.push_back(vectors.make(i, i));
+        ptrs.push_back(doubles.make((double)i));
+    }
+
+    EXPECT_EQ(PoolDirectory::find(ptrs[0]), vectors.deleterIndex());
+    EXPECT_EQ(PoolDirectory::find(ptrs[1]), doubles.deleterIndex());
+
+    for (void *p : ptrs)
+        EXPECT_TRUE(pool_free(p));
+
+    // Freed nodes go back to their own pools
+    Vector2<int> *v = vectors.make(1, 2);
+    double *d = doubles.make(3.0);
+    EXPECT_EQ((void*)v, ptrs[198]);
+    EXPECT_EQ((void*)d, ptrs[199]);
+    vectors.free(v);
+    doubles.free(d);
+}
+
+TEST(PoolDirectoryTest, IgnoresUnpooledPointers) {
+    int local = 0;
+    int *heap = new int(0);
+
+    EXPECT_FALSE(pool_free(nullptr));
+    EXPECT_FALSE(pool_free(&local));
+    EXPECT_FALSE(pool_free(heap));
+
+    delete heap;
+}
+
+TEST(PoolDirectoryTest, UnregistersChunks) {
+    Vector2<int> *p;
+    {
+        DirectoryPoolManager<Vector2<int> > manager(16);
+        p = manager.make(1, 2);
+        EXPECT_NE(PoolDirectory::find(p), 0);
+        manager.free(p);
+    }
+    EXPECT_EQ(PoolDirectory::find(p), 0);
+}
+
+TEST(PoolDirectoryTest, IgnoresHighAddresses) {
+    void *high = (void*)((uintptr_t)1 << 56);
+
+    EXPECT_EQ(PoolDirectory::find(high), 0);
+    EXPECT_FALSE(pool_free(high));
+    EXPECT_FALSE(PoolDirectory::covers(high, 1));
+    EXPECT_THROW(PoolDirectory::insert(high, PoolDirectory::PAGE_BYTES, 1), std::out_of_range);
+}
+
+TEST(PoolDirectoryTest, FillsPages) {
+    using Manager = DirectoryPoolManager<Vector2<int> >;
+    const size_t perPage = PoolDirectory::PAGE_BYTES / sizeof(Manager::PoolType::TNode);
+
+    EXPECT_EQ(Manager::fillPages(1), perPage);
+    EXPECT_EQ(Manager::fillPages(perPage), perPage);
+    EXPECT_EQ(Manager::fillPages(perPage + 1), 2 * perPage);
+    EXPECT_EQ(Manager::fillPages(0), 0);
+
+    Manager manager;
+    std::vector<Vector2<int>*> ptrs;
+    for (size_t i = 0; i < perPage; ++i)
+        ptrs.push_back(manager.make((int)i, 0));
+
+    // The first page holds a whole chunk
+    for (Vector2<int> *p : ptrs)
+        EXPECT_EQ((uintptr_t)p >> PoolDirectory::PAGE_SHIFT, (uintptr_t)ptrs[0] >> PoolDirectory::PAGE_SHIFT);
+
+    for (Vector2<int> *p : ptrs)
+        manager.free(p);
+}
@@ -0,0 +1,133 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <memory>
+#include <set>
+#include <vector>
+#include "duPoolManager.h"
+#include "duSharedPoolManager.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+using VectorPoolDeleter = PoolDeleter<MemPool<Vector2<int> >, Vector2<int> >;
+using UniqueVector = std::unique_ptr<Vector2<int>, VectorPoolDeleter>;
+
+TEST(PoolManagerTest, Makes) {
+    PoolManager<Vector2<int>, UniqueVector> manager;
+
+    UniqueVector v = manager.make(2, 3);
+
+    ASSERT_TRUE(v);
+    EXPECT_EQ(v->x, 2);
+    EXPECT_EQ(v->y, 3);
+}
+
+TEST(PoolManagerTest, MakesAndFreesBatches) {
+    PoolManager<Vector2<int>, UniqueVector> manager(16);
+
+    std::vector<UniqueVector> vecs(200);
+    EXPECT_EQ(manager.makeN(vecs.size(), vecs.data(), 4, 5), vecs.size());
+
+    for (auto &v : vecs) {
+        ASSERT_TRUE(v);
+        EXPECT_EQ(v->x, 4);
+        EXPECT_EQ(v->y, 5);
+    }
+
+    std::set<Vector2<int>*> raws;
+    for (auto &v : vecs)
+        raws.insert(v.get());
+
+    manager.freeN(vecs.data(), vecs.size());
+
+    for (auto &v : vecs)
+        EXPECT_FALSE(v);
+
+    // the freed memory is reused for the next batch
+    EXPECT_EQ(manager.makeN(vecs.size(), vecs.data(), 1, 1), vecs.size());
+    for (auto &v : vecs)
+        EXPECT_EQ(raws.count(v.get()), 1u);
+}
+
+TEST(DumbPoolManagerTest, MakesAndFrees) {
+    DumbPoolManager<Vector2<int> > manager;
+
+    DumbPtr<Vector2<int> > v1 = manager.make(2, 3);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    Vector2<int> *raw = v1.get();
+    v1.free();
+    EXPECT_FALSE(v1);
+
+    DumbPtr<Vector2<int> > v2 = manager.make(4, 5);
+    EXPECT_EQ(v2.get(), raw);
+    v2.free();
+}
+
+TEST(DumbPoolManagerTest, MakesAndFreesBatches) {
+    DumbPoolManager<Vector2<int> > manager(16);
+
+    std::vector<DumbPtr<Vector2<int> > > vecs(200);
+    EXPECT_EQ(manager.makeN(vecs.size(), vecs.data(), 6, 7), vecs.size());
+
+    for (auto &v : vecs) {
+        ASSERT_TRUE(v);
+        EXPECT_EQ(v->x, 6);
+        EXPECT_EQ(v->y, 7);
+    }
+
+    manager.freeN(vecs.data(), vecs.size());
+
+    for (auto &v : vecs)
+        EXPECT_FALSE(v);
+}
+
+TEST(SharedPoolManagerTest, MakesAndReuses) {
+    SharedPoolManager<Vector2<int> > manager(16);
+
+    std::shared_ptr<Vector2<int> > v1 = manager.make(2, 3);
+    ASSERT_TRUE(v1);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    std::weak_ptr<Vector2<int> > weak = v1;
+    std::shared_ptr<Vector2<int> > copy = v1;
+    v1.reset();
+    EXPECT_FALSE(weak.expired());
+
+    Vector2<int> *raw = copy.get();
+    copy.reset();
+    EXPECT_TRUE(weak.expired());
+    weak.reset();
+
+    // The object and its control block came from one pooled node, which is reused
+    std::shared_ptr<Vector2<int> > v2 = manager.make(4, 5);
+    EXPECT_EQ(v2.get(), raw);
+    EXPECT_EQ(manager.allocator().state()->poolCount(), 1);
+}
+
+TEST(SharedPoolManagerTest, OutlivesManager) {
+    std::shared_ptr<Vector2<int> > v;
+    {
+        SharedPoolManager<Vector2<int> > manager;
+        v = manager.make(6, 7);
+    }
+    EXPECT_EQ(v->x, 6);
+    EXPECT_EQ(v->y, 7);
+}
@@ -0,0 +1,106 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <thread>
+#include <vector>
+#include "duPoolRef.h"
+#include "duRemoteFreeMemPool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    struct Counted {
+        explicit Counted(int *destroyed) : destroyed(destroyed) {}
+        ~Counted() { ++*destroyed; }
+
+        int *destroyed;
+    };
+}
+
+TEST(PoolRefTest, CountsReferences) {
+    RefPoolManager<Vector2<int> > manager;
+
+    static_assert(sizeof(PoolRef<Vector2<int> >) == sizeof(void*), "PoolRef must be one pointer");
+
+    PoolRef<Vector2<int> > r1 = manager.make(2, 3);
+    ASSERT_TRUE(r1);
+    EXPECT_EQ(r1->x, 2);
+    EXPECT_EQ((*r1).y, 3);
+    EXPECT_EQ(r1.useCount(), 1);
+
+    PoolRef<Vector2<int> > r2 = r1;
+    EXPECT_EQ(r1.useCount(), 2);
+    EXPECT_EQ(r1, r2);
+
+    PoolRef<Vector2<int> > r3 = std::move(r2);
+    EXPECT_FALSE(r2);
+    EXPECT_EQ(r3.useCount(), 2);
+
+    r3 = nullptr;
+    EXPECT_EQ(r1.useCount(), 1);
+    EXPECT_EQ(r3.useCount(), 0);
+}
+
+TEST(PoolRefTest, ReturnsToPool) {
+    int destroyed = 0;
+    RefPoolManager<Counted> manager;
+
+    PoolRef<Counted> r1 = manager.make(&destroyed);
+    Counted *raw = r1.get();
+    {
+        PoolRef<Counted> copy = r1;
+        r1.reset();
+        EXPECT_EQ(destroyed, 0);
+    }
+    EXPECT_EQ(destroyed, 1);
+
+    // The freed slot is reused
+    PoolRef<Counted> r2 = manager.make(&destroyed);
+    EXPECT_EQ(r2.get(), raw);
+}
+
+TEST(PoolRefTest, SharesBetweenThreads) {
+    using Slot = PoolRefSlot<Vector2<int>, AtomicRefPolicy>;
+    using Manager = RefPoolManager<Vector2<int>, AtomicRefPolicy, std::allocator<MemNode<Slot> >,
+                                   RemoteFreeMemPool<Slot> >;
+
+    Manager manager(64);
+    std::vector<PoolRef<Vector2<int>, AtomicRefPolicy> > refs;
+    for (int i = 0; i < 100; ++i)
+        refs.push_back(manager.make(i, -i));
+
+    // Each thread copies every reference many times and drops its copies
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([refs]() {
+            for (int n = 0; n < 100; ++n) {
+                std::vector<PoolRef<Vector2<int>, AtomicRefPolicy> > copies(refs);
+                for (size_t i = 0; i < copies.size(); ++i)
+                    EXPECT_EQ(copies[i]->x, (int)i);
+            }
+        });
+    }
+
+    // Drop the original references while the threads still hold theirs
+    for (int i = 0; i < 100; ++i)
+        EXPECT_GE(refs[i].useCount(), 1u);
+    refs.clear();
+
+    for (auto &thread : threads)
+        thread.join();
+}
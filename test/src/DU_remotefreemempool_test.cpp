@@ -0,0 +1,107 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include "duPoolManager.h"
+#include "duRemoteFreeMemPool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(RemoteFreeMemPoolTest, FreesOnOwnerThread) {
+    RemoteFreeMemPool<Vector2<int> > vectorPool(10);
+
+    Vector2<int> *v1 = vectorPool.make(2, 3);
+    ASSERT_NE(v1, nullptr);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    vectorPool.free(v1);
+    EXPECT_EQ(vectorPool.collect(), 0);
+    EXPECT_EQ(vectorPool.make(4, 5), v1);
+}
+
+TEST(RemoteFreeMemPoolTest, CollectsRemoteFrees) {
+    RemoteFreeMemPool<Vector2<int> > vectorPool(16);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    for (int i = 0; i < 100; ++i)
+        vecPtrs.push_back(vectorPool.make(i, -i));
+
+    std::thread other([&]() {
+        for (int i = 0; i < 50; ++i)
+            vectorPool.free(vecPtrs[i]);
+        vectorPool.freeN(vecPtrs.data() + 50, 50);
+    });
+    other.join();
+
+    EXPECT_EQ(vectorPool.collect(), 100);
+
+    std::set<Vector2<int>*> freed(vecPtrs.begin(), vecPtrs.end());
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(freed.count(vectorPool.make(i, i)), 1u);
+}
+
+TEST(RemoteFreeMemPoolTest, FreesFromManyThreads) {
+    using Pool = RemoteFreeMemPool<Vector2<int> >;
+    using Deleter = PoolDeleter<Pool, Vector2<int> >;
+    using UniqueVector = std::unique_ptr<Vector2<int>, Deleter>;
+
+    const int numThreads = 4;
+    const int perThread = 1000;
+
+    PoolManager<Vector2<int>, UniqueVector, std::allocator<MemNode<Vector2<int> > >, Pool> manager(64);
+
+    std::vector<std::vector<UniqueVector> > handoff(numThreads);
+    std::set<Vector2<int>*> handedOff;
+    for (int t = 0; t < numThreads; ++t) {
+        for (int i = 0; i < perThread; ++i) {
+            handoff[t].push_back(manager.make(t, i));
+            handedOff.insert(handoff[t].back().get());
+        }
+    }
+
+    // Consumers destroy their objects while the owner keeps making new ones
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < numThreads; ++t)
+        consumers.emplace_back([&handoff, t]() { handoff[t].clear(); });
+
+    std::vector<UniqueVector> kept;
+    for (int i = 0; i < perThread; ++i)
+        kept.push_back(manager.make(i, -i));
+
+    for (auto &consumer : consumers)
+        consumer.join();
+
+    for (int i = 0; i < perThread; ++i) {
+        EXPECT_EQ(kept[i]->x, i);
+        EXPECT_EQ(kept[i]->y, -i);
+        handedOff.erase(kept[i].get());
+    }
+
+    // Every remotely freed node that was not reused yet is reused now
+    std::vector<UniqueVector> again;
+    size_t reused = 0;
+    for (int i = 0; i < numThreads * perThread; ++i) {
+        again.push_back(manager.make(i, i));
+        reused += handedOff.count(again.back().get());
+    }
+    EXPECT_EQ(reused, handedOff.size());
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <list>
+#include <memory_resource>
+#include <vector>
+#include "duSlabResource.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    // Forwards to new_delete_resource and counts what passes through
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        size_t allocations = 0;
+        size_t deallocations = 0;
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            ++allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            ++deallocations;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+
+TEST(SlabResourceTest, PicksSizeClasses) {
+    EXPECT_EQ(SlabResource::sizeClass(1, 1), 0);
+    EXPECT_EQ(SlabResource::sizeClass(8, 8), 0);
+    EXPECT_EQ(SlabResource::sizeClass(9, 1), 1);
+    EXPECT_EQ(SlabResource::sizeClass(4, 16), 1);
+    EXPECT_EQ(SlabResource::sizeClass(100, 4), 4);
+    EXPECT_EQ(SlabResource::sizeClass(4096, 8), 9);
+
+    EXPECT_EQ(SlabResource::sizeClass(4097, 8), SlabResource::NUM_CLASSES);
+    EXPECT_EQ(SlabResource::sizeClass(8, alignof(std::max_align_t) * 2), SlabResource::NUM_CLASSES);
+}
+
+TEST(SlabResourceTest, ReusesBlocks) {
+    CountingResource upstream;
+    SlabResource resource(16, &upstream);
+
+    // Every size class starts with one chunk
+    EXPECT_EQ(upstream.allocations, SlabResource::NUM_CLASSES);
+
+    void *a = resource.allocate(24, 8);
+    void *b = resource.allocate(32, 8);
+
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(upstream.allocations, SlabResource::NUM_CLASSES);
+
+    resource.deallocate(a, 24, 8);
+    EXPECT_EQ(resource.allocate(32, 8), a);
+
+    resource.deallocate(a, 32, 8);
+    resource.deallocate(b, 32, 8);
+    EXPECT_EQ(upstream.deallocations, 0);
+}
+
+TEST(SlabResourceTest, PassesLargeRequestsUpstream) {
+    CountingResource upstream;
+    SlabResource resource(16, &upstream);
+    size_t chunks = upstream.allocations;
+
+    void *big = resource.allocate(SlabResource::MAX_SIZE + 1, 8);
+    EXPECT_EQ(upstream.allocations, chunks + 1);
+
+    void *aligned = resource.allocate(64, alignof(std::max_align_t) * 2);
+    EXPECT_EQ(upstream.allocations, chunks + 2);
+    EXPECT_EQ((uintptr_t)aligned % (alignof(std::max_align_t) * 2), 0);
+
+    resource.deallocate(big, SlabResource::MAX_SIZE + 1, 8);
+    resource.deallocate(aligned, 64, alignof(std::max_align_t) * 2);
+    EXPECT_EQ(upstream.deallocations, 2);
+}
+
+TEST(SlabResourceTest, BacksContainers) {
+    SlabResource resource(32);
+
+    std::pmr::list<Vector2<int> > list(&resource);
+    std::pmr::vector<int> vec(&resource);
+
+    for (int i = 0; i < 200; ++i) {
+        list.emplace_back(i, -i);
+        vec.push_back(i);
+    }
+
+    int i = 0;
+    for (const Vector2<int> &v : list) {
+        EXPECT_EQ(v.x, i);
+        EXPECT_EQ(v.y, -i);
+        ++i;
+    }
+    for (i = 0; i < 200; ++i)
+        EXPECT_EQ(vec[i], i);
+}
+
+TEST(SlabResourceTest, Trims) {
+    CountingResource upstream;
+    SlabResource resource(4, &upstream);
+
+    // Releases the initial chunks of the unused size classes
+    EXPECT_EQ(resource.trim(), SlabResource::NUM_CLASSES);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 12; ++i)
+        blocks.push_back(resource.allocate(64, 8));
+
+    size_t chunks = upstream.allocations - upstream.deallocations;
+    EXPECT_GT(chunks, 0);
+    EXPECT_EQ(resource.trim(), 0);
+
+    for (void *p : blocks)
+        resource.deallocate(p, 64, 8);
+
+    EXPECT_EQ(resource.trim(), chunks);
+    EXPECT_EQ(upstream.allocations, upstream.deallocations);
+}
@@ -0,0 +1,79 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <cstdint>
+#include "duStackAllocator.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(StackAllocatorTest, MakesAndRollsBack) {
+    StackAllocator stack(1024);
+
+    Vector2<int> *v1 = stack.make<Vector2<int> >(2, 3);
+    ASSERT_NE(v1, nullptr);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    StackAllocator::Marker marker = stack.getMarker();
+
+    Vector2<int> *v2 = stack.make<Vector2<int> >(4, 5);
+    Vector2<int> *arr = stack.makeArray<Vector2<int> >(10, 7, 8);
+    ASSERT_NE(arr, nullptr);
+    EXPECT_EQ(v2, v1 + 1);
+    EXPECT_EQ(arr, v2 + 1);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(arr[i].x, 7);
+        EXPECT_EQ(arr[i].y, 8);
+    }
+
+    stack.freeToMarker(marker);
+    EXPECT_EQ(stack.used(), marker);
+    EXPECT_EQ(stack.make<Vector2<int> >(6, 7), v2);
+    EXPECT_EQ(v1->x, 2);
+}
+
+TEST(StackAllocatorTest, NestsScopes) {
+    StackAllocator stack(1024);
+
+    {
+        StackAllocator::Scope outer(stack);
+        void *a = stack.allocate(100);
+        size_t afterA = stack.used();
+
+        {
+            StackAllocator::Scope inner(stack);
+            void *b = stack.allocate(30, 64);
+            EXPECT_EQ((uintptr_t)b % 64, 0);
+            EXPECT_GT(stack.used(), afterA);
+        }
+        EXPECT_EQ(stack.used(), afterA);
+        EXPECT_NE(a, nullptr);
+    }
+    EXPECT_EQ(stack.used(), 0);
+}
+
+TEST(StackAllocatorTest, RunsOut) {
+    StackAllocator stack(64);
+
+    EXPECT_NE(stack.allocate(48), nullptr);
+    EXPECT_EQ(stack.allocate(32), nullptr);
+    EXPECT_EQ(stack.makeArray<int>((size_t)-1 / 2), nullptr);
+
+    stack.clear();
+    EXPECT_NE(stack.allocate(64), nullptr);
+}
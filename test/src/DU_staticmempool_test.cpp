@@ -0,0 +1,73 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "duStaticMemPool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+namespace {
+    StaticMemPool<Vector2<int>, 16> globalPool;
+
+    // Only compiles if the constructor is constexpr, which makes pools
+    // with static storage duration constant initialized
+    constexpr StaticMemPool<Vector2<int>, 4> constantPool;
+    static_assert(constantPool.capacity() == 4, "StaticMemPool must be constant initialized");
+}
+
+TEST(StaticMemPoolTest, AllocatesAndFrees) {
+    StaticMemPool<Vector2<int>, 4> vectorPool;
+
+    Vector2<int> *v1 = vectorPool.make(2, 3);
+    ASSERT_NE(v1, nullptr);
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+    EXPECT_TRUE(vectorPool.owns(v1));
+
+    vectorPool.free(v1);
+    EXPECT_EQ(vectorPool.make(4, 9), v1);
+}
+
+TEST(StaticMemPoolTest, IsContiguous) {
+    Vector2<int> *first = globalPool.make(0, 0);
+    for (int i = 1; i < 16; ++i)
+        EXPECT_EQ(globalPool.make(i, -i), first + i);
+
+    EXPECT_EQ(sizeof(globalPool), 16 * sizeof(MemNode<Vector2<int> >)
+                                  + sizeof(void*) + sizeof(size_t));
+
+    globalPool.clear();
+    EXPECT_EQ(globalPool.make(0, 0), first);
+    globalPool.clear();
+}
+
+TEST(StaticMemPoolTest, RunsOut) {
+    StaticMemPool<Vector2<int>, 4> vectorPool;
+
+    Vector2<int> *vecs[4];
+    for (int i = 0; i < 4; ++i)
+        vecs[i] = vectorPool.make(i, i);
+
+    EXPECT_EQ(vectorPool.make(5, 5), nullptr);
+
+    Vector2<int> local;
+    EXPECT_FALSE(vectorPool.owns(&local));
+
+    vectorPool.free(vecs[2]);
+    EXPECT_EQ(vectorPool.make(6, 6), vecs[2]);
+    EXPECT_EQ(vecs[2]->x, 6);
+}
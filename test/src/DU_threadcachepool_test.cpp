@@ -0,0 +1,112 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <thread>
+#include <vector>
+#include "duThreadCachePool.h"
+#include "duVector2.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(ThreadCachePoolTest, Allocates) {
+    ThreadCachePool<Vector2<int> > pool(4, 10);
+    ThreadCachePool<Vector2<int> >::Cache cache(pool);
+
+    Vector2<int> *v1 = cache.make(2, 3);
+
+    ASSERT_NE(v1, nullptr);
+
+    EXPECT_EQ(v1->x, 2);
+    EXPECT_EQ(v1->y, 3);
+
+    cache.free(v1);
+}
+
+TEST(ThreadCachePoolTest, Frees) {
+    ThreadCachePool<Vector2<int> > pool(4, 10);
+    ThreadCachePool<Vector2<int> >::Cache cache(pool);
+
+    Vector2<int> *v1 = cache.make(2, 3);
+    cache.free(v1);
+
+    // the cache should hand back the node that was just freed
+    Vector2<int> *v2 = cache.make(4, 5);
+    EXPECT_EQ(v1, v2);
+
+    cache.free(v2);
+}
+
+TEST(ThreadCachePoolTest, SharesBetweenCaches) {
+    ThreadCachePool<Vector2<int> > pool(4, 10);
+
+    std::vector<Vector2<int>* > vecPtrs;
+    {
+        ThreadCachePool<Vector2<int> >::Cache cache(pool);
+        for (int i = 0; i < 50; ++i)
+            vecPtrs.push_back(cache.make(i, -i));
+    }
+
+    // objects stay valid after the cache that made them is gone
+    // and can be freed through another cache
+    ThreadCachePool<Vector2<int> >::Cache other(pool);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(vecPtrs[i]->x, i);
+        EXPECT_EQ(vecPtrs[i]->y, -i);
+        other.free(vecPtrs[i]);
+    }
+}
+
+TEST(ThreadCachePoolTest, AllocatesFromThreads) {
+    const int numThreads = 8;
+    const int numObjects = 1000;
+
+    ThreadCachePool<Vector2<int> > pool(16, 64);
+    std::vector<std::vector<Vector2<int>* > > vecPtrs(numThreads);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&pool, &vecPtrs, t, numObjects]() {
+            ThreadCachePool<Vector2<int> >::Cache cache(pool);
+            for (int round = 0; round < 3; ++round) {
+                for (int i = 0; i < numObjects; ++i)
+                    vecPtrs[t].push_back(cache.make(t, i));
+                for (int i = 0; i < numObjects; i += 2)
+                    cache.free(vecPtrs[t][i]);
+                for (int i = 0; i < numObjects; i += 2)
+                    vecPtrs[t][i] = cache.make(t, i);
+                if (round < 2) {
+                    for (auto p : vecPtrs[t])
+                        cache.free(p);
+                    vecPtrs[t].clear();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    // every live object must have kept its own data
+    ThreadCachePool<Vector2<int> >::Cache cache(pool);
+    for (int t = 0; t < numThreads; ++t) {
+        ASSERT_EQ(vecPtrs[t].size(), (size_t)numObjects);
+        for (int i = 0; i < numObjects; ++i) {
+            EXPECT_EQ(vecPtrs[t][i]->x, t);
+            EXPECT_EQ(vecPtrs[t][i]->y, i);
+            cache.free(vecPtrs[t][i]);
+        }
+    }
+}
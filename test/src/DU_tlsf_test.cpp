@@ -0,0 +1,133 @@
+/*
+    Copyright 2017 Ahnaf Siddiqui
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+#include "duTlsf.h"
+#include "gtest/gtest.h"
+
+using namespace Diamond;
+
+TEST(TlsfTest, AllocatesAndFrees) {
+    Tlsf tlsf(4096);
+
+    void *a = tlsf.allocate(100);
+    void *b = tlsf.allocate(1);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_NE(a, b);
+    EXPECT_EQ((uintptr_t)a % Tlsf::ALIGN, 0);
+    EXPECT_EQ((uintptr_t)b % Tlsf::ALIGN, 0);
+    EXPECT_EQ(tlsf.used(), 112 + 16);
+
+    std::memset(a, 0xab, 100);
+    std::memset(b, 0xcd, 1);
+
+    tlsf.deallocate(a);
+    EXPECT_EQ(tlsf.used(), 16);
+
+    // The freed block is the best fit for the same size
+    EXPECT_EQ(tlsf.allocate(100), a);
+
+    tlsf.deallocate(a);
+    tlsf.deallocate(b);
+    tlsf.deallocate(nullptr);
+    EXPECT_EQ(tlsf.used(), 0);
+}
+
+TEST(TlsfTest, UsesCallerRegion) {
+    alignas(16) static char region[1024];
+    Tlsf tlsf(region, sizeof(region));
+
+    void *a = tlsf.allocate(200);
+    ASSERT_NE(a, nullptr);
+    EXPECT_GE((char*)a, region);
+    EXPECT_LT((char*)a, region + sizeof(region));
+
+    EXPECT_EQ(tlsf.allocate(2000), nullptr);
+    tlsf.deallocate(a);
+}
+
+TEST(TlsfTest, RejectsTinyRegions) {
+    // The region is freed again, which LeakSanitizer checks
+    EXPECT_THROW(Tlsf tlsf(8), std::bad_alloc);
+}
+
+TEST(TlsfTest, CoalescesFreeBlocks) {
+    const size_t regionSize = 64 * 1024;
+    Tlsf tlsf(regionSize);
+
+    std::vector<void*> blocks;
+    while (void *p = tlsf.allocate(200))
+        blocks.push_back(p);
+    EXPECT_GT(blocks.size(), 200u);
+
+    // Free every other block, then the rest, in an order that
+    // merges with neighbours on both sides
+    for (size_t i = 0; i < blocks.size(); i += 2)
+        tlsf.deallocate(blocks[i]);
+    EXPECT_EQ(tlsf.allocate(1000), nullptr);
+    for (size_t i = 1; i < blocks.size(); i += 2)
+        tlsf.deallocate(blocks[i]);
+
+    EXPECT_EQ(tlsf.used(), 0);
+
+    // Everything merged back into one block
+    void *big = tlsf.allocate(regionSize - 1024);
+    EXPECT_NE(big, nullptr);
+    tlsf.deallocate(big);
+}
+
+TEST(TlsfTest, SurvivesRandomUse) {
+    Tlsf tlsf(1 << 20);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> sizeDist(1, 5000);
+
+    struct Live {
+        unsigned char *p;
+        size_t size;
+        unsigned char fill;
+    };
+    std::vector<Live> live;
+
+    for (int i = 0; i < 20000; ++i) {
+        if (live.empty() || rng() % 3 != 0) {
+            size_t size = sizeDist(rng);
+            unsigned char *p = static_cast<unsigned char*>(tlsf.allocate(size));
+            if (p) {
+                unsigned char fill = (unsigned char)i;
+                std::memset(p, fill, size);
+                live.push_back(Live{p, size, fill});
+            }
+        }
+        if (!live.empty() && (live.size() > 200 || rng() % 2 == 0)) {
+            size_t index = rng() % live.size();
+            Live entry = live[index];
+            for (size_t j = 0; j < entry.size; ++j)
+                ASSERT_EQ(entry.p[j], entry.fill);
+            tlsf.deallocate(entry.p);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+
+    for (const Live &entry : live)
+        tlsf.deallocate(entry.p);
+    EXPECT_EQ(tlsf.used(), 0);
+}